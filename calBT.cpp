@@ -5,45 +5,426 @@
  * under the Eclipse Public License.
  */
 
+#include <math.h>
+
+#include <OsiSolverInterface.hpp>
+#include <OsiCuts.hpp>
+#include <CoinHelperFunctions.hpp>
+
 #include "calBT.hpp"
 #include "calInstance.hpp"
 #include "calModel.hpp"
+#include "calProfile.hpp"
+#include "calTrace.hpp"
 
 //#define DEBUG
 
+calBT::calBT (calInstance *inst, calModel *model):
+  instance_   (inst),
+  model_      (model),
+  nRows_      (0),
+  firstRow_   (0),
+  rowBeg_     (NULL),
+  rowInd_     (NULL),
+  rowVal_     (NULL),
+  rowLo_      (NULL),
+  rowUp_      (NULL),
+  colBeg_     (NULL),
+  colRow_     (NULL),
+  lastLb_     (NULL),
+  lastUb_     (NULL),
+  minSq_      (NULL),
+  sumMinSq_   (0.),
+  lastCutoff_ (COIN_DBL_MAX),
+  lastBudget_ (COIN_DBL_MAX),
+  queue_      (NULL),
+  qHead_      (0),
+  qSize_      (0),
+  inQueue_    (NULL),
+  touched_    (NULL),
+  nTouched_   (0),
+  isTouched_  (NULL) {}
+
+// copies only the pointers to data: the row-wise copy is rebuilt at
+// the first call as the clone may work on a different LP
+
+calBT::calBT (const calBT &rhs):
+  CglCutGenerator (rhs),
+  instance_   (rhs.instance_),
+  model_      (rhs.model_),
+  nRows_      (0),
+  firstRow_   (0),
+  rowBeg_     (NULL),
+  rowInd_     (NULL),
+  rowVal_     (NULL),
+  rowLo_      (NULL),
+  rowUp_      (NULL),
+  colBeg_     (NULL),
+  colRow_     (NULL),
+  lastLb_     (NULL),
+  lastUb_     (NULL),
+  minSq_      (NULL),
+  sumMinSq_   (0.),
+  lastCutoff_ (COIN_DBL_MAX),
+  lastBudget_ (COIN_DBL_MAX),
+  queue_      (NULL),
+  qHead_      (0),
+  qSize_      (0),
+  inQueue_    (NULL),
+  touched_    (NULL),
+  nTouched_   (0),
+  isTouched_  (NULL) {}
+
+calBT::~calBT () {
+
+  delete [] rowBeg_;
+  delete [] rowInd_;
+  delete [] rowVal_;
+  delete [] rowLo_;
+  delete [] rowUp_;
+  delete [] colBeg_;
+  delete [] colRow_;
+  delete [] lastLb_;
+  delete [] lastUb_;
+  delete [] minSq_;
+  delete [] queue_;
+  delete [] inQueue_;
+  delete [] touched_;
+  delete [] isTouched_;
+}
+
 //
-// Bound tightening: use cutoff to set bounds on all delta_i (= w_i -
-// d_i) variables
+// Build a row-wise copy of the rows created by populate () that are
+// linear in (delta,s): cardinality (index 2N), sum of deltas (2N+1),
+// calibration (2N+2 ... 2N+1+p), and linking rows (2N+2+p
+// ... 4N+1+p). Cone rows and cuts are not considered. If the linking
+// rows are not in the LP (see calInstance::linkObjects ()), they are
+// added to the copy so that propagation still enforces them.
 //
 
-void calBT::generateCuts (const OsiSolverInterface & si, 
+void calBT::setup (const OsiSolverInterface &si) const {
+
+  bool linkRows = !(instance_ -> linkObjects ());
+
+  int
+    N     = instance_ -> N (),
+    n     = instance_ -> n (),
+    p     = instance_ -> p (),
+    nCols = 1 + 2*N,
+    nLP;
+
+  double
+    U  = (double) N * N / n,
+    w0 = (double) N     / n;
+
+  firstRow_ = 2*N;
+  nLP       = CoinMin (si.getNumRows (), 2*N + 2 + p + (linkRows ? 2*N : 0)) - firstRow_;
+
+  if (nLP < 0)
+    nLP = 0;
+
+  nRows_ = nLP + (linkRows ? 0 : 2*N);
+
+  const CoinPackedMatrix *m = si.getMatrixByRow ();
+
+  const CoinBigIndex *beg = m -> getVectorStarts  ();
+  const int          *len = m -> getVectorLengths ();
+  const int          *ind = m -> getIndices       ();
+  const double       *val = m -> getElements      ();
+
+  int nnz = linkRows ? 0 : 4*N;
+
+  for (int r=0; r<nLP; ++r)
+    nnz += len [firstRow_ + r];
+
+  rowBeg_ = new int    [nRows_ + 1];
+  rowInd_ = new int    [nnz];
+  rowVal_ = new double [nnz];
+  rowLo_  = new double [nRows_];
+  rowUp_  = new double [nRows_];
+
+  CoinCopyN (si.getRowLower () + firstRow_, nLP, rowLo_);
+  CoinCopyN (si.getRowUpper () + firstRow_, nLP, rowUp_);
+
+  colBeg_ = new int [nCols + 1];
+  colRow_ = new int [nnz];
+
+  CoinZeroN (colBeg_, nCols + 1);
+
+  nnz = 0;
+
+  for (int r=0; r<nLP; ++r) {
+
+    rowBeg_ [r] = nnz;
+
+    for (CoinBigIndex k = beg [firstRow_ + r], kEnd = k + len [firstRow_ + r]; k < kEnd; ++k)
+
+      if (ind [k] < nCols) {
+
+	rowInd_ [nnz]   = ind [k];
+	rowVal_ [nnz++] = val [k];
+      }
+  }
+
+  // linking rows delta_i + w0 s_i >= 0 and delta_i + (w0 - U) s_i <= 0
+
+  for (int r = nLP, i = 0; r < nRows_; ++r, i = (i+1) % N) {
+
+    bool lower = (r - nLP < N);
+
+    rowBeg_ [r] = nnz;
+
+    rowInd_ [nnz]   = 1 + i;
+    rowVal_ [nnz++] = 1.;
+    rowInd_ [nnz]   = 1 + N + i;
+    rowVal_ [nnz++] = lower ? w0 : w0 - U;
+
+    rowLo_ [r] = lower ? 0.           : -COIN_DBL_MAX;
+    rowUp_ [r] = lower ? COIN_DBL_MAX : 0.;
+  }
+
+  rowBeg_ [nRows_] = nnz;
+
+  // column-wise index
+
+  for (int k=0; k<nnz; ++k)
+    ++colBeg_ [rowInd_ [k] + 1];
+
+  for (int j=0; j<nCols; ++j)
+    colBeg_ [j+1] += colBeg_ [j];
+
+  int *cursor = CoinCopyOfArray (colBeg_, nCols);
+
+  for (int r=0; r<nRows_; ++r)
+    for (int k = rowBeg_ [r]; k < rowBeg_ [r+1]; ++k)
+      colRow_ [cursor [rowInd_ [k]] ++] = r;
+
+  delete [] cursor;
+
+  // state and scratch space
+
+  lastLb_    = new double [nCols];
+  lastUb_    = new double [nCols];
+  minSq_     = new double [N];
+  queue_     = new int    [nRows_ + 1];
+  inQueue_   = new char   [nRows_ + 1];
+  touched_   = new int    [nCols];
+  isTouched_ = new char   [nCols];
+
+  CoinZeroN (minSq_,     N);
+  CoinZeroN (inQueue_,   nRows_ + 1);
+  CoinZeroN (isTouched_, nCols);
+
+  sumMinSq_ = 0.;
+  qHead_ = qSize_ = nTouched_ = 0;
+}
+
+//
+// Column col has new bounds in lastLb_/lastUb_: update the distance
+// of zero from its interval (if it is a delta) and wake up its rows
+//
+
+void calBT::touch (int col) const {
+
+  int N = instance_ -> N ();
+
+  if (!isTouched_ [col]) {
+    isTouched_ [col] = 1;
+    touched_ [nTouched_++] = col;
+  }
+
+  if ((col >= 1) && (col <= N)) {
+
+    double
+      l = lastLb_ [col],
+      u = lastUb_ [col],
+      m = (l > 0.) ? l : (u < 0.) ? -u : 0.;
+
+    sumMinSq_ += m*m - minSq_ [col-1];
+    minSq_ [col-1] = m*m;
+  }
+
+  for (int k = colBeg_ [col]; k < colBeg_ [col+1]; ++k) {
+
+    int r = colRow_ [k];
+
+    if (!inQueue_ [r]) {
+      inQueue_ [r] = 1;
+      queue_ [(qHead_ + qSize_++) % nRows_] = r;
+    }
+  }
+}
+
+//
+// Intersect bounds of col with [lb,ub], rounding them if col is an s
+// variable. Returns false if the resulting interval is empty
+//
+
+bool calBT::tighten (int col, double lb, double ub) const {
+
+  if (col > instance_ -> N ()) { // s variables are binary
+    lb = ceil  (lb - 1e-6);
+    ub = floor (ub + 1e-6);
+  }
+
+  double
+    &curLb = lastLb_ [col],
+    &curUb = lastUb_ [col];
+
+  bool changed = false;
+
+  if (lb > curLb + BT_TOL * (1. + fabs (curLb))) {curLb = lb; changed = true;}
+  if (ub < curUb - BT_TOL * (1. + fabs (curUb))) {curUb = ub; changed = true;}
+
+  if (curLb > curUb + BT_TOL * (1. + fabs (curUb)))
+    return false;
+
+  if (changed)
+    touch (col);
+
+  return true;
+}
+
+//
+// Interval propagation on a single row: lo <= sum_k a_k x_k <= up
+//
+
+bool calBT::propagateRow (int r) const {
+
+  double
+    minAct = 0.,
+    maxAct = 0.,
+    lo     = rowLo_ [r],
+    up     = rowUp_ [r];
+
+  int
+    beg = rowBeg_ [r],
+    end = rowBeg_ [r+1];
+
+  for (int k=beg; k<end; ++k) {
+
+    double
+      a = rowVal_ [k],
+      l = lastLb_ [rowInd_ [k]],
+      u = lastUb_ [rowInd_ [k]];
+
+    if ((l < -1e20) || (u > 1e20)) // only propagate rows with bounded variables
+      return true;
+
+    if (a > 0.) {minAct += a * l; maxAct += a * u;}
+    else        {minAct += a * u; maxAct += a * l;}
+  }
+
+  double tol = BT_TOL * (1. + CoinMax (fabs (minAct), fabs (maxAct)));
+
+  if (((up <  1e20) && (minAct > up + tol)) ||
+      ((lo > -1e20) && (maxAct < lo - tol)))
+    return false;
+
+  for (int k=beg; k<end; ++k) {
+
+    int    j = rowInd_ [k];
+    double a = rowVal_ [k],
+      l = lastLb_ [j],
+      u = lastUb_ [j],
+      newLb = -COIN_DBL_MAX,
+      newUb =  COIN_DBL_MAX;
+
+    if (a > 0.) {
+      if (up <  1e20) newUb = l + (up - minAct) / a;
+      if (lo > -1e20) newLb = u + (lo - maxAct) / a;
+    } else {
+      if (up <  1e20) newLb = u + (up - minAct) / a;
+      if (lo > -1e20) newUb = l + (lo - maxAct) / a;
+    }
+
+    if (!tighten (j, newLb, newUb))
+      return false;
+  }
+
+  return true;
+}
+
+//
+// Bound tightening: use cutoff, ball, and linear rows to set bounds
+// on delta_i (= w_i - d_i) and s_i variables
+//
+
+void calBT::generateCuts (const OsiSolverInterface & si,
 			  OsiCuts & cs,
 			  const CglTreeInfo info) const {
 
   int
-    N = instance_ -> N (),
+    N     = instance_ -> N (),
+    nCols = 1 + 2*N;
+
+  calProfTimer timer (instance_ -> profile (), PROF_BT);
+  calTraceSpan span  ("bound tightening", "pass", info.pass);
+
+  bool firstCall = (NULL == rowBeg_);
+
+  if (firstCall)
+    setup (si);
+
+  // cutoff of the BB running this generator: model_ is the root
+  // model, while each BB run works on a clone, which sets the cutoff
+  // (from its incumbent, or -F) as the dual objective limit of si
+
+  double
+    cutoff = model_ -> bestObj (),
+    limit;
+
+  if (si. getDblParam (OsiDualObjectiveLimit, limit) && (limit < cutoff))
+    cutoff = limit;
+
+  const double
+    *lb = si. getColLower (),
+    *ub = si. getColUpper ();
+
+  nTouched_ = 0;
+
+  // 1) Wake up columns whose bounds changed since last call
+
+  for (int j=0; j<nCols; ++j)
+    if (firstCall || (lb [j] != lastLb_ [j]) || (ub [j] != lastUb_ [j])) {
+      lastLb_ [j] = lb [j];
+      lastUb_ [j] = ub [j];
+      touch (j);
+    }
+
+  // 2) Cutoff inequalities |delta_i| <= cutoff, globally valid. Only
+  // need a full scan when the cutoff improves
+
+  int
     *indicesL = new int [N],
     *indicesU = new int [N],
-    nLower = 0, 
+    nLower = 0,
     nUpper = 0;
 
-  double 
-    cutoff = model_ -> bestObj (),
+  double
     *newlb = new double [N],
     *newub = new double [N];
 
-  const double
-    *lb = si. getColLower () + 1, // to start from delta [0]
-    *ub = si. getColUpper () + 1;
+  // TODO: if objective is sum delta/d, newlb/ub has to be multiplied by d_i
 
-  for (int i=1; i<=N; ++i) {
+  if (cutoff < 1e20) {
 
-    // TODO: if objective is sum delta/d, newlb/ub has to be multiplied by d_i
+    bool fullScan = (cutoff < lastCutoff_);
 
-    if (*lb++ < -cutoff) {indicesL [nLower] = i; newlb [nLower++] = -cutoff;}
-    if (*ub++ >  cutoff) {indicesU [nUpper] = i; newub [nUpper++] =  cutoff;}
+    for (int k = 0, kEnd = fullScan ? N : nTouched_; k < kEnd; ++k) {
+
+      int i = fullScan ? 1 + k : touched_ [k];
+
+      if ((i < 1) || (i > N))
+	continue;
+
+      if (lb [i] < -cutoff) {indicesL [nLower] = i; newlb [nLower++] = -cutoff;}
+      if (ub [i] >  cutoff) {indicesU [nUpper] = i; newub [nUpper++] =  cutoff;}
+    }
   }
 
+  lastCutoff_ = cutoff;
+
   if (nLower || nUpper) {
 
     OsiColCut *cut = new OsiColCut;
@@ -58,7 +439,8 @@ void calBT::generateCuts (const OsiSolverInterface & si,
 #endif
 
     cs.insert (cut);
-  
+    timer. count (1);
+
     delete cut;
   }
 
@@ -66,4 +448,130 @@ void calBT::generateCuts (const OsiSolverInterface & si,
   delete [] newub;
   delete [] indicesL;
   delete [] indicesU;
+
+  // 3) Alternate propagation on linear rows and on the ball
+  // ||delta||_2 <= cutoff, only from what changed
+
+  bool feasible = true;
+
+  for (int round = 0; feasible && round < BT_MAX_ROUNDS; ++round) {
+
+    for (int nVisits = BT_MAX_VISITS * nRows_; feasible && qSize_ && nVisits--;) {
+
+      int r = queue_ [qHead_];
+
+      qHead_ = (qHead_ + 1) % nRows_;
+      --qSize_;
+      inQueue_ [r] = 0;
+
+      feasible = propagateRow (r);
+    }
+
+    if (!feasible || (cutoff > 1e20))
+      break;
+
+    // delta_i^2 <= cutoff^2 - sum_{k != i} m_k^2 = budget + m_i^2
+
+    double budget = cutoff * cutoff - sumMinSq_;
+
+    if (budget < - BT_TOL * (1. + cutoff * cutoff)) { // cannot improve on cutoff at this node
+      feasible = false;
+      break;
+    }
+
+    // full scan only if the budget shrank since last time, otherwise
+    // the bounds of untouched deltas are at least as tight as needed
+
+    bool fullScan = (budget < lastBudget_ - BT_TOL * (1. + fabs (lastBudget_)));
+    int  nPrevTouched = nTouched_;
+
+    lastBudget_ = budget;
+
+    for (int k = 0, kEnd = fullScan ? N : nPrevTouched; feasible && k < kEnd; ++k) {
+
+      int i = fullScan ? 1 + k : touched_ [k];
+
+      if ((i < 1) || (i > N))
+	continue;
+
+      double radius = sqrt (CoinMax (0., budget + minSq_ [i-1]));
+
+      feasible = tighten (i, -radius, radius);
+    }
+
+    if (!qSize_)
+      break;
+  }
+
+  // empty queue for next call
+
+  for (; qSize_; --qSize_) {
+    inQueue_ [queue_ [qHead_]] = 0;
+    qHead_ = (qHead_ + 1) % nRows_;
+  }
+
+  if (!feasible) {
+
+    // infeasible node: add a cut 0 >= inf
+
+    OsiRowCut rc;
+    rc.setLb (COIN_DBL_MAX);
+    rc.setUb (0.);
+    cs.insert (rc);
+    timer. count (1);
+
+    // forget this node's bounds
+
+    for (int k=0; k<nTouched_; ++k) {
+      lastLb_ [touched_ [k]] = -COIN_DBL_MAX;
+      lastUb_ [touched_ [k]] =  COIN_DBL_MAX;
+      isTouched_ [touched_ [k]] = 0;
+    }
+
+    return;
+  }
+
+  // 4) Locally valid column cut with all tightened bounds
+
+  int
+    *indL = new int [nTouched_],
+    *indU = new int [nTouched_];
+
+  double
+    *valL = new double [nTouched_],
+    *valU = new double [nTouched_];
+
+  nLower = nUpper = 0;
+
+  for (int k=0; k<nTouched_; ++k) {
+
+    int j = touched_ [k];
+
+    isTouched_ [j] = 0;
+
+    if (lastLb_ [j] > lb [j]) {indL [nLower] = j; valL [nLower++] = lastLb_ [j];}
+    if (lastUb_ [j] < ub [j]) {indU [nUpper] = j; valU [nUpper++] = lastUb_ [j];}
+  }
+
+  if (nLower || nUpper) {
+
+    OsiColCut *cut = new OsiColCut;
+
+    if (nLower) cut -> setLbs (nLower, indL, valL);
+    if (nUpper) cut -> setUbs (nUpper, indU, valU);
+
+#ifdef DEBUG
+    cut -> print ();
+#endif
+
+    cs.insert (cut);
+    timer. count (1);
+
+    delete cut;
+  }
+
+  delete [] indL;
+  delete [] indU;
+  delete [] valL;
+  delete [] valU;
 }
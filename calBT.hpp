@@ -15,9 +15,29 @@ class calModel;
 class OsiSolverInterface;
 class OsiCuts;
 
+#define BT_TOL          1e-7 // minimum (relative) change to record a tightened bound
+#define BT_MAX_ROUNDS   3    // alternations between linear rows and cutoff ball
+#define BT_MAX_VISITS  10    // max # visits of each row per call
+
+//
+// Bound tightening. Combines:
+//
+// 1) cutoff inequalities: the objective function is ||delta||_2, so
+//    if z is a valid cutoff a valid bound tightening is |delta_i| <=
+//    cutoff (globally valid);
+//
+// 2) the ball ||delta||_2 <= cutoff with the current bounds: if m_k
+//    is the distance of zero from [l_k,u_k], then delta_i^2 <=
+//    cutoff^2 - sum_{k != i} m_k^2 (valid at this node);
 //
-// Cutoff inequalities: the objective function is ||delta||_2, so if z
-// is a valid cutoff a valid bound tightening is |delta_i| <= cutoff
+// 3) interval propagation on the cardinality, sum-of-deltas,
+//    calibration and linking rows of the model, with rounding of the
+//    s variables (valid at this node). Linking rows are propagated
+//    even when they are not in the LP (option -S).
+//
+// The generator remembers the bounds seen at the previous call
+// (i.e. the parent node when diving) and only wakes up the rows of
+// the columns whose bounds changed since then.
 //
 
 class calBT: public CglCutGenerator {
@@ -27,15 +47,54 @@ protected:
   calInstance *instance_;
   calModel    *model_;
 
+  // Row-wise copy of the linear rows of the model, built at the first
+  // call, and its column-wise index
+
+  mutable int     nRows_;      ///< number of propagated rows (0 until first call)
+  mutable int     firstRow_;   ///< index in the LP of the first propagated row
+  mutable int    *rowBeg_;     ///< starts of rows, size nRows_ + 1
+  mutable int    *rowInd_;     ///< column indices
+  mutable double *rowVal_;     ///< coefficients
+  mutable double *rowLo_;      ///< row lower bounds
+  mutable double *rowUp_;      ///< row upper bounds
+  mutable int    *colBeg_;     ///< starts of columns in colRow_, size 2N+2
+  mutable int    *colRow_;     ///< propagated rows in which each column appears
+
+  // State kept between calls
+
+  mutable double *lastLb_;     ///< bounds at previous call (plus our tightenings)
+  mutable double *lastUb_;
+  mutable double *minSq_;      ///< squared distance of 0 from [lb_i,ub_i] for each delta_i
+  mutable double  sumMinSq_;   ///< sum of the above
+  mutable double  lastCutoff_; ///< cutoff at previous call
+  mutable double  lastBudget_; ///< cutoff^2 - sumMinSq_ at previous call
+
+  // Scratch space: row queue and list of touched columns
+
+  mutable int    *queue_;
+  mutable int     qHead_, qSize_;
+  mutable char   *inQueue_;
+  mutable int    *touched_;
+  mutable int     nTouched_;
+  mutable char   *isTouched_;
+
+  void setup   (const OsiSolverInterface &si) const; ///< build row-wise copy
+  void touch   (int col) const;                      ///< update minSq_ and wake up rows of col
+  bool tighten (int col, double lb, double ub) const; ///< false if infeasible
+  bool propagateRow (int row) const;                  ///< false if infeasible
+
 public:
 
-  calBT (calInstance *inst, calModel *model): instance_ (inst), model_ (model) {}
+  calBT (calInstance *inst, calModel *model);
+  calBT (const calBT &rhs);
+
+  ~calBT ();
 
-  calBT *clone () const {return new calBT (instance_, model_);}
+  calBT *clone () const {return new calBT (*this);}
 
-  void generateCuts (const OsiSolverInterface & si, 
+  void generateCuts (const OsiSolverInterface & si,
 		     OsiCuts & cs,
-		     const CglTreeInfo info = CglTreeInfo ()) const; 
+		     const CglTreeInfo info = CglTreeInfo ()) const;
 };
 
 #endif
@@ -0,0 +1,360 @@
+/*
+ * optimal calibrated sampling -- batch mode
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OsiClpSolverInterface.hpp>
+#include <CoinFinite.hpp>
+
+#include "calInstance.hpp"
+#include "calOutput.hpp"
+#include "calClock.hpp"
+#include "calQueue.hpp"
+#include "calTrace.hpp"
+#include "cmdLine.hpp"
+
+//
+// Batch mode (option -B): the instances listed in a manifest file are
+// run through a pipeline of four stages, each in its own thread and
+// connected to the next by a bounded queue:
+//
+//   parse    -- read the instance file and the command line options
+//   populate -- remove redundant calibration vectors, build and
+//               presolve the root MILP
+//   solve    -- run all replications (in the calling thread)
+//   write    -- wait for the .sol file to be written, free everything
+//
+// so that the next instances are read and populated while one is
+// solved, and the previous one is still being written. The queues
+// bound the number of instances in memory. A stage whose thread
+// cannot be created runs in the calling thread. The manifest has one
+// instance per line, optionally followed by its output file (default:
+// the instance file with .txt replaced by .sol); empty lines and
+// those starting with '#' are skipped. Option -T limits the time of
+// each instance, from the start of its solve stage. With -J, the
+// profiling report of each instance is named after its output file,
+// with extension .json.
+//
+
+#define BATCH_QUEUE_SIZE 2    // instances waiting between two stages
+#define BATCH_MAX_LINE   4096 // longest manifest line
+
+calInstance *readInstance (char *filename, tpar *options, int argc, char **argv);
+
+void calBuildRoot (calInstance *instance, OsiClpSolverInterface &model);
+int  calSolve     (calInstance *instance, calOutput *out, const OsiClpSolverInterface *root);
+
+// an instance going through the pipeline
+
+struct calBatchJob {
+
+  char                  *file;
+  char                  *outFile;
+  calInstance           *instance;
+  OsiClpSolverInterface *root;
+  calOutput             *out;
+  int                    nSamples;
+};
+
+// what the stage threads share
+
+struct calBatch {
+
+  FILE                *manifest;
+  tpar                *options;
+  int                  argc;
+  char               **argv;
+  const volatile bool *stop;
+
+  calQueue *parsed;
+  calQueue *populated;
+  calQueue *solved;
+
+  int nInstances;
+  int nSamples;
+};
+
+static char *copyString (const char *s) {
+
+  char *c = (char *) malloc (strlen (s) + 1);
+  strcpy (c, strlen (s) + 1, s);
+  return c;
+}
+
+static void deleteJob (calBatchJob *job) {
+
+  delete job -> instance;
+  delete job -> root;
+
+  free (job -> file);
+  free (job -> outFile);
+
+  delete job;
+}
+
+//
+// Stage 1: read the instances listed in the manifest
+//
+
+// the next instance in the manifest, or NULL at its end (or on stop)
+
+static calBatchJob *parseNext (calBatch *batch) {
+
+  char line [BATCH_MAX_LINE];
+
+  while (!*(batch -> stop) && fgets (line, BATCH_MAX_LINE, batch -> manifest)) {
+
+    char
+      file    [BATCH_MAX_LINE],
+      outFile [BATCH_MAX_LINE];
+
+    int nTokens = sscanf (line, "%s %s", file, outFile);
+
+    if ((nTokens < 1) || (*file == '#'))
+      continue;
+
+    calInstance *instance = readInstance (file, batch -> options, batch -> argc, batch -> argv);
+
+    if (!instance)
+      continue;
+
+    calBatchJob *job = new calBatchJob;
+
+    job -> file     = copyString (file);
+    job -> instance = instance;
+    job -> root     = NULL;
+    job -> out      = NULL;
+    job -> nSamples = 0;
+
+    if (nTokens > 1)
+      job -> outFile = copyString (outFile);
+    else {
+
+      job -> outFile = (char *) malloc (strlen (file) + 5);
+      strcpy (job -> outFile, strlen (file) + 1, file);
+
+      char *exthook = strstr (job -> outFile, ".txt");
+      if (!exthook)
+	exthook = job -> outFile + strlen (job -> outFile);
+
+      strcpy (exthook, 5, ".sol");
+    }
+
+    if (instance -> outFile ()) { // one output file per instance
+      free (instance -> outFile ());
+      instance -> outFile () = NULL;
+    }
+
+    if (instance -> profileFile ()) { // and one report, named after it
+
+      char *report = (char *) malloc (strlen (job -> outFile) + 6);
+      strcpy (report, strlen (job -> outFile) + 1, job -> outFile);
+
+      char *exthook = strrchr (report, '.');
+      if (!exthook || strchr (exthook, '/'))
+	exthook = report + strlen (report);
+
+      strcpy (exthook, 6, ".json");
+
+      free (instance -> profileFile ());
+      instance -> profileFile () = report;
+    }
+
+    return job;
+  }
+
+  return NULL;
+}
+
+static void parseStage (void *arg) {
+
+  calBatch *batch = (calBatch *) arg;
+
+  calBatchJob *job;
+
+  calTraceThread ("parse");
+
+  while ((job = parseNext (batch)))
+    batch -> parsed -> push (job);
+
+  batch -> parsed -> close ();
+}
+
+//
+// Stage 2: build the root MILP
+//
+
+static void populateJob (calBatch *batch, calBatchJob *job) {
+
+  if (*(batch -> stop))
+    return;
+
+  calInstance *instance = job -> instance;
+
+  if (!(instance -> noPresolve ())) {
+
+    int nRemoved = instance -> removeRedundantX ();
+
+    if (nRemoved)
+      printf ("%s: removed %d redundant calibration vector(s)\n", job -> file, nRemoved);
+  }
+
+  instance -> print ();
+
+  job -> root = new OsiClpSolverInterface;
+  calBuildRoot (instance, *(job -> root));
+}
+
+static void populateStage (void *arg) {
+
+  calBatch *batch = (calBatch *) arg;
+
+  calBatchJob *job;
+
+  calTraceThread ("populate");
+
+  while ((job = (calBatchJob *) batch -> parsed -> pop ())) {
+    populateJob (batch, job);
+    batch -> populated -> push (job);
+  }
+
+  batch -> populated -> close ();
+}
+
+//
+// Stage 4: wait for the output to be written
+//
+
+static void writeJob (calBatch *batch, calBatchJob *job) {
+
+  if (job -> out) {
+
+    calTraceSpan span ("write output");
+
+    delete job -> out; // waits for all samples to be written
+
+    printf ("%s: %d sample(s) written to %s\n", job -> file, job -> nSamples, job -> outFile);
+
+    ++ (batch -> nInstances);
+    batch -> nSamples += job -> nSamples;
+  }
+
+  deleteJob (job);
+}
+
+static void writeStage (void *arg) {
+
+  calBatch *batch = (calBatch *) arg;
+
+  calBatchJob *job;
+
+  calTraceThread ("write");
+
+  while ((job = (calBatchJob *) batch -> solved -> pop ()))
+    writeJob (batch, job);
+}
+
+//
+// Run all instances in the manifest. Returns the number of instances
+// solved, or -1 if the manifest cannot be read
+//
+
+int calBatchRun (const char *manifest, tpar *options, int argc, char **argv, const volatile bool *stop) {
+
+  calBatch batch;
+
+  if (!(batch. manifest = fopen (manifest, "r"))) {
+    printf ("Error: cannot read manifest %s\n", manifest);
+    return -1;
+  }
+
+  batch. options    = options;
+  batch. argc       = argc;
+  batch. argv       = argv;
+  batch. stop       = stop;
+  batch. parsed     = new calQueue (BATCH_QUEUE_SIZE);
+  batch. populated  = new calQueue (BATCH_QUEUE_SIZE);
+  batch. solved     = new calQueue (BATCH_QUEUE_SIZE);
+  batch. nInstances = 0;
+  batch. nSamples   = 0;
+
+  double start = calWallTime ();
+
+  calThread
+    parser    (parseStage,    &batch),
+    populater (populateStage, &batch),
+    writer    (writeStage,    &batch);
+
+  // a stage whose thread could not start is run here, one instance
+  // at a time. Without the parser, populate is run here too, as its
+  // thread (if any) then gets no input and only closes its queue
+
+  if (!parser. started ())
+    batch. parsed -> close ();
+
+  bool
+    inlinePopulate = !parser. started () || !populater. started (),
+    inlineWrite    = !writer. started ();
+
+  if (!parser. started () || !populater. started () || !writer. started ())
+    printf ("Warning: cannot start all batch threads, running the%s%s%s stage(s) in the main thread\n",
+	    parser.    started () ? "" : " parse",
+	    inlinePopulate        ? " populate" : "",
+	    writer.    started () ? "" : " write");
+
+  //
+  // Stage 3: solve, in this thread
+  //
+
+  calBatchJob *job;
+
+  calTraceThread ("solve");
+
+  while ((job = !parser. started () ? parseNext (&batch) :
+	  inlinePopulate ? (calBatchJob *) batch. parsed    -> pop () :
+	                   (calBatchJob *) batch. populated -> pop ())) {
+
+    if (inlinePopulate)
+      populateJob (&batch, job);
+
+    if (!*stop) {
+
+      calInstance *instance = job -> instance;
+
+      // the time limit starts now, not when the program did
+
+      instance -> deadline () = (instance -> maxTotalTime () >= 0.) ?
+	calWallTime () + instance -> maxTotalTime () : COIN_DBL_MAX;
+
+      printf ("%s: writing file %s\n", job -> file, job -> outFile);
+
+      job -> out      = new calOutput (instance, job -> outFile); // writes from a separate thread
+      job -> nSamples = calSolve (instance, job -> out, job -> root);
+    }
+
+    if (inlineWrite) writeJob (&batch, job);
+    else             batch. solved -> push (job);
+  }
+
+  batch. solved -> close ();
+
+  parser.    join ();
+  populater. join ();
+  writer.    join ();
+
+  fclose (batch. manifest);
+
+  delete batch. parsed;
+  delete batch. populated;
+  delete batch. solved;
+
+  printf ("Batch: %d instance(s), %d sample(s) (%gs)\n", batch. nInstances, batch. nSamples, calWallTime () - start);
+
+  return batch. nInstances;
+}
@@ -0,0 +1,445 @@
+/*
+ * optimal calibrated sampling -- microbenchmarks of the main kernels
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <OsiClpSolverInterface.hpp>
+#include <OsiCuts.hpp>
+#include <CglTreeInfo.hpp>
+#include <CoinHelperFunctions.hpp>
+
+#include "calInstance.hpp"
+#include "calModel.hpp"
+#include "calCube.hpp"
+#include "calCut.hpp"
+#include "calWeights.hpp"
+#include "calClock.hpp"
+#include "calRandom.hpp"
+#include "calSynth.hpp"
+#include "cmdLine.hpp"
+
+//
+// calbench: times the kernels below on random populations (see
+// calSynth.hpp), for each combination of the population sizes N, the
+// numbers p of calibration vectors and the densities of nonzero
+// calibration values given (the sample size is N/10):
+//
+//   project      CalCubeHeur::project (), all units fractional
+//   standalone   CalCubeHeur::standalone (), from s = n/N
+//   cut          calCut::generateCuts () at the sample below, with z = 0
+//   check        calModel::checkSolution () of a sample of n distinct
+//                units with their optimal weights (from calWeights)
+//   populate     populate () of the root MILP
+//   parse        calInstance (filename), from a file written first
+//
+// Each measurement is repeated in a number of trials, each running
+// the kernel for at least a given time, and the minimum and median
+// time per call are reported, one line (CSV) or object (JSON) per
+// kernel and input, in the order above. The inputs depend only on the
+// options, so that the outputs of two versions have the same lines in
+// the same order and can be compared line by line; the calls column,
+// like the times, depends on the speed of each kernel.
+//
+
+#define BENCH_MAX_LIST  64 // values in each list of option
+#define BENCH_MAX_DRAWS 10 // samples drawn to find one with feasible weights
+
+int populate (calInstance *instance, OsiSolverInterface *problem);
+
+enum benchKernel {BENCH_PROJECT, BENCH_STANDALONE, BENCH_CUT, BENCH_CHECK, BENCH_POPULATE, BENCH_PARSE, BENCH_NKERNELS};
+
+static const char *kernelName [BENCH_NKERNELS] = {"project", "standalone", "cut", "check", "populate", "parse"};
+
+// gives the benchmark access to the projection
+
+class calBenchCube: public CalCubeHeur {
+
+public:
+
+  calBenchCube (calInstance *inst): CalCubeHeur (inst) {}
+
+  using CalCubeHeur::project;
+};
+
+// inputs of all kernels for a population
+
+struct benchInput {
+
+  calSynthSpec           spec;
+  calInstance           *instance;
+  calBenchCube          *cube;
+  OsiClpSolverInterface *lp;       ///< root MILP
+  calModel              *model;
+  calCut                *cut;
+  double                *v, *u, *pi, *s0;
+  double                *solution; ///< point of the MILP, 1+2N
+  bool                   feasible; ///< solution is a calibrated sample
+  char                   filename [100];
+};
+
+static void setup (benchInput &in, const calSynthSpec &spec) {
+
+  int N = spec.N;
+
+  in.spec = spec;
+
+  double *x = calSynthX (spec);
+
+  if (!x) {
+    printf ("Error: population of %d units with %d calibration values too large\n", N, spec.p);
+    exit (-1);
+  }
+
+  in.instance = new calInstance (N, spec.n, spec.p, x);
+  in.instance -> randSeed () = spec.seed;
+  in.instance -> seedRandom ();
+
+  sprintf (in.filename, "calbench-%d-%d-%g.txt", N, spec.p, spec.density);
+
+  if (!calSynthWrite (in.filename, spec, x))
+    *(in.filename) = 0;
+
+  delete [] x;
+
+  in.cube = new calBenchCube (in.instance);
+
+  in.lp = new OsiClpSolverInterface;
+  in.lp -> messageHandler () -> setLogLevel (0);
+  populate (in.instance, in.lp);
+
+  in.model = new calModel (*(in.lp), in.instance);
+  in.cut   = new calCut (in.instance);
+
+  in.v        = new double [N];
+  in.u        = new double [N];
+  in.pi       = new double [N];
+  in.s0       = new double [N];
+  in.solution = new double [1 + 2*N];
+
+  unsigned short rng [3];
+
+  calSeedRandom (rng, spec.seed);
+
+  CoinFillN (in.pi, N, (double) spec.n / N);
+
+  for (int i=0; i<N; ++i)
+    in.v [i] = -1. + 2. * calRandom (rng);
+
+  // a sample of n distinct units and its optimal weights. The LP
+  // gets it with z = 0, which violates all conic cuts; the point
+  // checked has z = ||delta||
+
+  calWeights weights (in.instance);
+
+  int *unit = new int [N];
+
+  double
+    *s     = in.solution + 1 + N,
+    *delta = in.solution + 1,
+    f      = COIN_DBL_MAX;
+
+  for (int draw = 0; (draw < BENCH_MAX_DRAWS) && (f >= COIN_DBL_MAX); ++draw) {
+
+    for (int i=0; i<N; ++i)
+      unit [i] = i;
+
+    CoinZeroN (s, N);
+
+    for (int k=0; k<spec.n; ++k) { // first n of a random permutation
+
+      int j = k + (int) (calRandom (rng) * (N - k));
+
+      std::swap (unit [k], unit [j]);
+      s [unit [k]] = 1.;
+    }
+
+    f = weights. solve (s, delta);
+  }
+
+  delete [] unit;
+
+  in.feasible = (f < COIN_DBL_MAX);
+
+  if (!in.feasible) {
+    printf ("Warning: no calibrated sample of %d units found, \"check\" not timed\n", spec.n);
+    CoinZeroN (delta, N);
+  }
+
+  in.solution [0] = 0.;
+  in.lp -> setColSolution (in.solution);
+  in.solution [0] = in.feasible ? f : 0.;
+}
+
+static void cleanup (benchInput &in) {
+
+  if (*(in.filename))
+    remove (in.filename);
+
+  delete [] in.v;
+  delete [] in.u;
+  delete [] in.pi;
+  delete [] in.s0;
+  delete [] in.solution;
+
+  delete in.cut;
+  delete in.model;
+  delete in.lp;
+  delete in.cube;
+  delete in.instance;
+}
+
+// one call of a kernel. Returns false if it cannot run on this input
+
+static bool runKernel (enum benchKernel kernel, benchInput &in) {
+
+  int N = in.spec.N;
+
+  switch (kernel) {
+
+  case BENCH_PROJECT:
+
+    in.cube -> project (in.v, in.u, in.pi);
+    break;
+
+  case BENCH_STANDALONE:
+
+    CoinFillN (in.s0, N, (double) in.spec.n / N);
+    in.cube -> standalone (in.s0);
+    break;
+
+  case BENCH_CUT: {
+
+    OsiCuts cs;
+    in.cut -> generateCuts (*(in.lp), cs, CglTreeInfo ());
+    break;
+  }
+
+  case BENCH_CHECK:
+
+    if (!in.feasible)
+      return false;
+
+    in.model -> checkSolution (1e40, in.solution, 0, 0.);
+    break;
+
+  case BENCH_POPULATE: {
+
+    OsiClpSolverInterface lp;
+    populate (in.instance, &lp);
+    break;
+  }
+
+  case BENCH_PARSE:
+
+    if (!*(in.filename))
+      return false;
+
+    delete new calInstance (in.filename);
+    break;
+
+  default: return false;
+  }
+
+  return true;
+}
+
+// minimum and median seconds per call over nTrials trials of at least
+// minTime seconds each. Returns the total number of calls (0 if the
+// kernel cannot run)
+
+static int measure (enum benchKernel kernel, benchInput &in, int nTrials, double minTime,
+		    double &minSec, double &medSec) {
+
+  double *perCall = new double [nTrials];
+
+  int nCalls = 0;
+
+  for (int t=0; t<nTrials; ++t) {
+
+    int k = 0;
+
+    double
+      start = calWallTime (),
+      elapsed;
+
+    do {
+
+      if (!runKernel (kernel, in)) {
+	delete [] perCall;
+	return 0;
+      }
+
+      ++k;
+
+    } while ((elapsed = calWallTime () - start) < minTime);
+
+    perCall [t] = elapsed / k;
+    nCalls += k;
+  }
+
+  std::sort (perCall, perCall + nTrials);
+
+  minSec = perCall [0];
+  medSec = (nTrials % 2) ? perCall [nTrials / 2] : .5 * (perCall [nTrials / 2 - 1] + perCall [nTrials / 2]);
+
+  delete [] perCall;
+
+  return nCalls;
+}
+
+int main (int argc, char *argv []) {
+
+  bool needHelp = false;
+
+  int
+    nTrials = 5,
+    seed    = 1;
+
+  double minTime = .1;
+
+  tpar options [] = {{ 'N', (char *) "sizes",        0, NULL,     ::TSTRING, (char *) "population sizes, comma-separated (default: 1000,10000)"}
+		     ,{'p', (char *) "calib",        0, NULL,     ::TSTRING, (char *) "numbers of calibration vectors (default: 4,16)"}
+		     ,{'d', (char *) "density",      0, NULL,     ::TSTRING, (char *) "densities of nonzero calibration values (default: 1,.1)"}
+		     ,{'k', (char *) "kernels",      0, NULL,     ::TSTRING, (char *) "kernels to time: project,standalone,cut,check,populate,parse (default: all)"}
+		     ,{'r', (char *) "trials",       5, &nTrials, ::TINT,    (char *) "trials of each measurement"}
+		     ,{'t', (char *) "time",        .1, &minTime, ::TDOUBLE, (char *) "minimum seconds of each trial"}
+		     ,{'s', (char *) "seed",         1, &seed,    ::TINT,    (char *) "random seed of the populations"}
+		     ,{'f', (char *) "format",       0, NULL,     ::TSTRING, (char *) "output format: \"csv\" (default) or \"json\""}
+		     ,{'o', (char *) "output",       0, NULL,     ::TSTRING, (char *) "output file (default: standard output)"}
+		     ,{'h', (char *) "help",         0, &needHelp, ::TTOGGLE, (char *) "print this help"}
+		     ,{0,   (char *) "",             0, NULL,     ::TTOGGLE, (char *) ""} /* THIS ENTRY ALWAYS AT THE END */
+  };
+
+  set_default_args (options);
+
+  char
+    *sizes   = NULL,
+    *calib   = NULL,
+    *density = NULL,
+    *kernels = NULL,
+    *format  = NULL,
+    *output  = NULL;
+
+  options [0].par = &sizes; // after set_default_args, as they are NULL
+  options [1].par = &calib;
+  options [2].par = &density;
+  options [3].par = &kernels;
+  options [7].par = &format;
+  options [8].par = &output;
+
+  char **filenames = readargs (argc, argv, options);
+
+  if (filenames) {
+    for (int i=0; filenames [i]; ++i)
+      free (filenames [i]);
+    free (filenames);
+  }
+
+  if (needHelp) {
+    printf ("%s -- microbenchmarks of calibri's kernels on random populations\n\n", argv [0]);
+    print_help (argv [0], options);
+    return 0;
+  }
+
+  double
+    sizeList    [BENCH_MAX_LIST],
+    calibList   [BENCH_MAX_LIST],
+    densityList [BENCH_MAX_LIST];
+
+  int
+    nSizes   = read_list (sizes,   sizeList,    BENCH_MAX_LIST),
+    nCalib   = read_list (calib,   calibList,   BENCH_MAX_LIST),
+    nDensity = read_list (density, densityList, BENCH_MAX_LIST);
+
+  if (!nSizes)   {sizeList    [0] = 1000; sizeList    [1] = 10000; nSizes   = 2;}
+  if (!nCalib)   {calibList   [0] = 4;    calibList   [1] = 16;    nCalib   = 2;}
+  if (!nDensity) {densityList [0] = 1.;   densityList [1] = .1;    nDensity = 2;}
+
+  bool run [BENCH_NKERNELS];
+
+  for (int k=0; k<BENCH_NKERNELS; ++k)
+    run [k] = !kernels || strstr (kernels, kernelName [k]);
+
+  bool json = format && !strcmp (format, "json");
+
+  FILE *f = output ? fopen (output, "w") : stdout;
+
+  if (!f) {
+    printf ("Error: cannot write %s\n", output);
+    return -1;
+  }
+
+  if (json) fprintf (f, "[");
+  else      fprintf (f, "kernel,N,p,density,calls,min_seconds,median_seconds\n");
+
+  bool first = true;
+
+  for       (int iN=0; iN<nSizes;   ++iN)
+    for     (int ip=0; ip<nCalib;   ++ip)
+      for   (int id=0; id<nDensity; ++id) {
+
+	calSynthSpec spec;
+
+	spec.N       = (int) sizeList [iN];
+	spec.n       = CoinMax (1, spec.N / 10);
+	spec.p       = (int) calibList [ip];
+	spec.density = densityList [id];
+	spec.seed    = seed;
+
+	if ((spec.N < 2) || (spec.p < 1))
+	  continue;
+
+	benchInput in;
+
+	setup (in, spec);
+
+	for (int k=0; k<BENCH_NKERNELS; ++k) {
+
+	  if (!run [k])
+	    continue;
+
+	  double minSec, medSec;
+
+	  int nCalls = measure ((enum benchKernel) k, in, CoinMax (1, nTrials), minTime, minSec, medSec);
+
+	  if (!nCalls)
+	    continue;
+
+	  if (json)
+	    fprintf (f, "%s\n  {\"kernel\": \"%s\", \"N\": %d, \"p\": %d, \"density\": %g, \"calls\": %d, \"min_seconds\": %.9g, \"median_seconds\": %.9g}",
+		     first ? "" : ",", kernelName [k], spec.N, spec.p, spec.density, nCalls, minSec, medSec);
+	  else
+	    fprintf (f, "%s,%d,%d,%g,%d,%.9g,%.9g\n",
+		     kernelName [k], spec.N, spec.p, spec.density, nCalls, minSec, medSec);
+
+	  fflush (f);
+
+	  first = false;
+	}
+
+	cleanup (in);
+      }
+
+  if (json)
+    fprintf (f, "\n]\n");
+
+  if (output)
+    fclose (f);
+
+  free (sizes);
+  free (calib);
+  free (density);
+  free (kernels);
+  free (format);
+  free (output);
+
+  return 0;
+}
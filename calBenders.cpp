@@ -0,0 +1,116 @@
+/*
+ * optimal calibrated sampling -- Benders cuts
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <math.h>
+
+#include <OsiSolverInterface.hpp>
+#include <OsiCuts.hpp>
+#include <OsiRowCut.hpp>
+#include <CoinHelperFunctions.hpp>
+#include <CoinFinite.hpp>
+
+#include "calBenders.hpp"
+#include "calWeights.hpp"
+#include "calInstance.hpp"
+
+//#define DEBUG
+
+void calBenders::generateCuts (const OsiSolverInterface & si,
+			       OsiCuts & cs,
+			       const CglTreeInfo info) const {
+  int
+    N = instance_ -> N (),
+    n = instance_ -> n ();
+
+  const double
+    *sol   = si. getColSolution (),
+    theta  = sol [0],
+    *s     = sol + 1;
+
+  double
+    *delta = new double [N],
+    *coeff = new double [N+1],
+    rhs;
+
+  int *indices = new int [N+1];
+
+  double f = weights_ -> solve (s, delta, coeff + 1, &rhs);
+
+  if (!(weights_ -> optimal ())) {
+
+    // active-set method stopped early: its multipliers give no valid
+    // bound, and a failed residual check does not prove infeasibility
+
+#ifdef DEBUG
+    printf ("Benders: weight subproblem not solved, no cut\n");
+#endif
+
+  } else if (f < COIN_DBL_MAX) {
+
+    // optimality cut theta - sum_i coef_i s_i >= rhs, if violated
+
+    if (theta < f - BENDERS_MIN_VIOLATION * (1. + f)) {
+
+      int nnz = 1;
+
+      indices [0] = 0;
+      coeff   [0] = 1.;
+
+      for (int i=0; i<N; ++i)
+	if (coeff [1+i] != 0.) {
+	  indices [nnz]   = 1+i;
+	  coeff   [nnz++] = -coeff [1+i];
+	}
+
+      OsiRowCut cut;
+
+      cut. setLb  (rhs);
+      cut. setUb  (COIN_DBL_MAX);
+      cut. setRow (nnz, indices, coeff);
+      cut. setGloballyValid (true);
+
+#ifdef DEBUG
+      printf ("Benders: theta = %g, ||delta|| = %g\n", theta, f);
+      cut. print ();
+#endif
+
+      cs. insert (cut);
+    }
+
+  } else {
+
+    // no feasible weights: cut off this sample, if it is one
+
+    int nOnes = 0;
+
+    for (int i=0; i<N; ++i)
+      if      (s [i] > 1. - 1e-6) indices [nOnes++] = 1+i;
+      else if (s [i] >      1e-6) break;
+
+    if (nOnes == n) {
+
+      CoinFillN (coeff, n, 1.);
+
+      OsiRowCut cut;
+
+      cut. setLb  (-COIN_DBL_MAX);
+      cut. setUb  (n - 1);
+      cut. setRow (n, indices, coeff);
+      cut. setGloballyValid (true);
+
+#ifdef DEBUG
+      printf ("Benders: infeasible sample\n");
+#endif
+
+      cs. insert (cut);
+    }
+  }
+
+  delete [] delta;
+  delete [] coeff;
+  delete [] indices;
+}
@@ -0,0 +1,58 @@
+/*
+ * optimal calibrated sampling -- Benders cuts
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calBenders_hpp
+#define calBenders_hpp
+
+#include <CglCutGenerator.hpp>
+
+class calInstance;
+class calWeights;
+class OsiSolverInterface;
+class OsiCuts;
+
+#define BENDERS_MIN_VIOLATION 1e-6 // relative violation of theta >= ||delta*(s)||
+
+//
+// Benders decomposition (option -D). The master problem (built by
+// populateMaster () in calPopulate.cpp) only has the s variables, the
+// cardinality constraint and a variable theta that underestimates
+// ||delta||_2.
+// At each LP solution (theta, s), the weight subproblem is solved
+// analytically by calWeights, and
+//
+// 1) if ||delta*(s)|| > theta, the optimality cut
+//    theta >= rhs + sum_i coef_i s_i is added (globally valid);
+//
+// 2) if s is integer and no feasible delta exists, the no-good cut
+//    sum_{i: s_i = 1} s_i <= n - 1 is added.
+//
+// The generator must also be called at integer solutions (lazy
+// constraints), as these are otherwise accepted on theta alone.
+//
+
+class calBenders: public CglCutGenerator {
+
+protected:
+
+  calInstance *instance_;
+  calWeights  *weights_;  ///< not owned
+
+public:
+
+  calBenders (calInstance *inst, calWeights *weights):
+    instance_ (inst),
+    weights_  (weights) {}
+
+  calBenders *clone () const {return new calBenders (instance_, weights_);}
+
+  void generateCuts (const OsiSolverInterface & si,
+		     OsiCuts & cs,
+		     const CglTreeInfo info = CglTreeInfo ()) const;
+};
+
+#endif
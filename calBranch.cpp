@@ -0,0 +1,221 @@
+/*
+ * optimal calibrated sampling -- branching on s variables
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <math.h>
+
+#include <OsiSolverInterface.hpp>
+#include <CoinHelperFunctions.hpp>
+
+#include "calBranch.hpp"
+#include "calInstance.hpp"
+#include "calModel.hpp"
+
+//#define DEBUG
+
+calBranch::calBranch (CbcModel *model, calInstance *inst, int unit,
+		      double downPsCost, double upPsCost):
+
+  CbcSimpleIntegerDynamicPseudoCost (model, 1 + inst -> N () + unit, downPsCost, upPsCost),
+  instance_ (inst),
+  unit_     (unit) {}
+
+calBranch::calBranch (const calBranch &rhs):
+
+  CbcSimpleIntegerDynamicPseudoCost (rhs),
+  instance_ (rhs.instance_),
+  unit_     (rhs.unit_) {}
+
+// infeasibility of s_i scaled by its leverage
+
+double calBranch::infeasibility (const OsiBranchingInformation *info,
+				 int &preferredWay) const {
+
+  double value = CbcSimpleIntegerDynamicPseudoCost::infeasibility (info, preferredWay);
+
+  if ((value <= 0.) || !(instance_ -> leverageBranch ()))
+    return value;
+
+  int N = instance_ -> N ();
+
+  double
+    w0    = (double) N / instance_ -> n (),
+    xNorm = instance_ -> xNorm () [unit_],
+    s     = info -> solution_ [1 + N + unit_],
+    delta = info -> solution_ [1     + unit_],
+    down  = xNorm * fabs (w0 * s + delta), // calibration change if s_i -> 0
+    up    = xNorm * w0 * (1. - s);         // calibration change if s_i -> 1
+
+  // normalize so that a unit with s_i = 1/2 and delta_i = 0 has
+  // leverage ||x_i||_2 (only relative values matter)
+
+  double leverage = 2. * sqrt (CoinMax (down, 0.) * CoinMax (up, 0.)) / w0;
+
+#ifdef DEBUG
+  printf ("s_%d = %g, delta = %g: infeas %g, leverage %g\n", unit_, s, delta, value, leverage);
+#endif
+
+  return value * CoinMax (leverage, PSCOST_MIN);
+}
+
+//
+// Semicontinuous object on (delta_i, s_i)
+//
+
+calLink::calLink (CbcModel *model, calInstance *inst, int unit,
+		  double downPsCost, double upPsCost):
+
+  calBranch (model, inst, unit, downPsCost, upPsCost) {}
+
+calLink::calLink (const calLink &rhs):
+
+  calBranch (rhs) {}
+
+// infeasibility of s_i, or of the pair if s_i = 0 and delta_i != 0
+
+double calLink::infeasibility (const OsiBranchingInformation *info,
+			       int &preferredWay) const {
+
+  double value = calBranch::infeasibility (info, preferredWay);
+
+  if (value > 0.)
+    return value;
+
+  int
+    N     = instance_ -> N (),
+    sCol  = 1 + N + unit_;
+
+  double
+    s     = info -> solution_ [sCol],
+    delta = info -> solution_ [1 + unit_];
+
+  // if s_i is fixed, propagation (calBT) takes care of delta_i and
+  // checkSolution () rejects violations
+
+  if ((s > .5) ||
+      (fabs (delta) <= info -> integerTolerance_) ||
+      (info -> upper_ [sCol] - info -> lower_ [sCol] < .5))
+    return 0.;
+
+  preferredWay = -1;
+
+  return CoinMin (.5, CoinMax (info -> integerTolerance_, fabs (delta) * instance_ -> n () / N));
+}
+
+// branch on s_i, also fixing delta_i on the down branch
+
+CbcBranchingObject *calLink::createCbcBranch (OsiSolverInterface *solver,
+					      const OsiBranchingInformation *info,
+					      int way) {
+
+  int col = columnNumber ();
+
+  double value = info -> solution_ [col];
+
+  value = CoinMax (value, info -> lower_ [col]);
+  value = CoinMin (value, info -> upper_ [col]);
+
+  // s_i integral but delta_i != 0: branch as if s_i = 1/2
+
+  if (fabs (value - floor (value + .5)) <= info -> integerTolerance_)
+    value = .5;
+
+  calLinkBranchingObject *newObject =
+    new calLinkBranchingObject (model_, col, way, value, this, 1 + unit_);
+
+  double
+    up   = upDynamicPseudoCost   () * (ceil (value) - value),
+    down = downDynamicPseudoCost () * (value - floor (value)),
+    changeInGuessed = (way > 0) ? down - up : up - down;
+
+  newObject -> setChangeInGuessed (CoinMax (0., changeInGuessed));
+  newObject -> setOriginalObject  (this);
+
+  return newObject;
+}
+
+calLinkBranchingObject::calLinkBranchingObject (CbcModel *model, int variable, int way, double value,
+						CbcSimpleIntegerDynamicPseudoCost *object, int deltaCol):
+
+  CbcDynamicPseudoCostBranchingObject (model, variable, way, value, object),
+  deltaCol_ (deltaCol) {}
+
+calLinkBranchingObject::calLinkBranchingObject (const calLinkBranchingObject &rhs):
+
+  CbcDynamicPseudoCostBranchingObject (rhs),
+  deltaCol_ (rhs.deltaCol_) {}
+
+// same as Cbc's, plus delta_i = 0 on the down branch. Cbc flips way_
+// in branch (), so check it before
+
+double calLinkBranchingObject::branch () {
+
+  bool down = (way_ < 0);
+
+  double retval = CbcDynamicPseudoCostBranchingObject::branch ();
+
+  if (down) {
+    model_ -> solver () -> setColLower (deltaCol_, 0.);
+    model_ -> solver () -> setColUpper (deltaCol_, 0.);
+  }
+
+  return retval;
+}
+
+//
+// Replace the objects of all s variables with calBranch objects, or
+// calLink objects if the linking rows are not in the LP
+//
+
+void addBranchObjects (calModel &calbb, calInstance *inst, const double *freq) {
+
+  int N = inst -> N ();
+
+  double
+    w0 = (double) N / inst -> n (),
+    *xNorm = CoinCopyOfArray (inst -> xNorm (), N);
+
+  // scale norms so that the average unit has unit norm
+
+  double avgNorm = 0.;
+
+  for (int i=0; i<N; ++i)
+    avgNorm += xNorm [i];
+
+  avgNorm /= N;
+
+  if (avgNorm > 0.)
+    for (int i=0; i<N; ++i)
+      xNorm [i] /= avgNorm;
+
+  CbcObject **objects = new CbcObject * [N];
+
+  for (int i=0; i<N; ++i) {
+
+    // without frequencies, Cbc's default pseudocost (objective
+    // coefficient, zero here) is replaced by the neutral 1/2
+
+    double
+      pi     = freq ? freq [i] : .5,
+      scale  = w0 * CoinMax (xNorm [i], PSCOST_MIN),
+      psDown = scale * CoinMax (pi,      PSCOST_MIN),
+      psUp   = scale * CoinMax (1. - pi, PSCOST_MIN);
+
+    objects [i] = inst -> linkObjects () ?
+      new calLink   (&calbb, inst, i, psDown, psUp) :
+      new calBranch (&calbb, inst, i, psDown, psUp);
+  }
+
+  // replaces simple integers on the same columns
+
+  calbb. addObjects (N, objects);
+
+  for (int i=0; i<N; ++i)
+    delete objects [i];
+
+  delete [] objects;
+  delete [] xNorm;
+}
@@ -0,0 +1,116 @@
+/*
+ * optimal calibrated sampling -- branching on s variables
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calBranch_hpp
+#define calBranch_hpp
+
+#include <CbcSimpleIntegerDynamicPseudoCost.hpp>
+#include <CbcBranchDynamic.hpp>
+
+class calInstance;
+class calModel;
+
+#define PSCOST_MIN 1e-3 // smallest seeded pseudocost (relative to w0 * ||x_i||)
+
+//
+// Branching object for a single s_i. Rounding s_i down removes the
+// weight w_i = w0 s_i + delta_i of unit i, and hence w_i x_i from the
+// calibration totals, which must be compensated by the other deltas;
+// rounding it up adds w0 (1 - s_i) x_i. The leverage of s_i on the
+// calibration residual is the geometric mean of these two changes,
+// and is used to scale the (pseudocost-based) infeasibility Cbc ranks
+// the candidates with.
+//
+
+class calBranch: public CbcSimpleIntegerDynamicPseudoCost {
+
+protected:
+
+  calInstance *instance_;
+  int          unit_;     ///< index i of s_i within the population
+
+public:
+
+  calBranch (CbcModel *model, calInstance *inst, int unit,
+	     double downPsCost, double upPsCost);
+
+  calBranch (const calBranch &rhs);
+
+  virtual CbcObject *clone () const
+  {return new calBranch (*this);}
+
+  /// infeasibility of s_i scaled by its leverage
+  virtual double infeasibility (const OsiBranchingInformation *info,
+				int &preferredWay) const;
+};
+
+//
+// Semicontinuous object for the pair (delta_i, s_i), used in place of
+// the linking rows -w0 s_i <= delta_i <= (U - w0) s_i when these are
+// not in the LP (option -S). Besides being fractional, s_i is
+// infeasible if it is zero while delta_i is not; branching down fixes
+// both s_i and delta_i to zero, branching up fixes s_i to one (the
+// bounds of delta_i are then those of its column).
+//
+
+class calLink: public calBranch {
+
+public:
+
+  calLink (CbcModel *model, calInstance *inst, int unit,
+	   double downPsCost, double upPsCost);
+
+  calLink (const calLink &rhs);
+
+  virtual CbcObject *clone () const
+  {return new calLink (*this);}
+
+  /// infeasibility of s_i, or of the pair if s_i = 0 and delta_i != 0
+  virtual double infeasibility (const OsiBranchingInformation *info,
+				int &preferredWay) const;
+
+  /// branch on s_i, also fixing delta_i on the down branch
+  virtual CbcBranchingObject *createCbcBranch (OsiSolverInterface *solver,
+					       const OsiBranchingInformation *info,
+					       int way);
+};
+
+//
+// Branching object for calLink: same as Cbc's (to keep pseudocosts
+// updated) but sets delta_i = 0 on the down branch
+//
+
+class calLinkBranchingObject: public CbcDynamicPseudoCostBranchingObject {
+
+protected:
+
+  int deltaCol_; ///< column of delta_i
+
+public:
+
+  calLinkBranchingObject (CbcModel *model, int variable, int way, double value,
+			  CbcSimpleIntegerDynamicPseudoCost *object, int deltaCol);
+
+  calLinkBranchingObject (const calLinkBranchingObject &rhs);
+
+  virtual CbcBranchingObject *clone () const
+  {return new calLinkBranchingObject (*this);}
+
+  virtual double branch ();
+};
+
+//
+// Replace the objects of all s variables with calBranch objects (or
+// calLink objects if the linking rows are not in the LP). If
+// freq is not NULL, it contains the inclusion frequency of each unit
+// over several Cube runs, used to seed the pseudocosts: a unit that
+// is often included is expensive to drop, and vice versa.
+//
+
+void addBranchObjects (calModel &calbb, calInstance *inst, const double *freq);
+
+#endif
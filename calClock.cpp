@@ -0,0 +1,66 @@
+/*
+ * optimal calibrated sampling -- wall-clock time and deadlines
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <CoinFinite.hpp>
+
+#include "calClock.hpp"
+
+// current value of a monotonic clock, in seconds
+
+static double monotonicTime () {
+
+#ifdef _MSC_VER
+
+  LARGE_INTEGER count, freq;
+
+  QueryPerformanceCounter   (&count);
+  QueryPerformanceFrequency (&freq);
+
+  return (double) count.QuadPart / (double) freq.QuadPart;
+
+#else
+
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+
+#endif
+}
+
+// set before main () and never changed, hence safe to read from any
+// thread
+
+static const double startTime = monotonicTime ();
+
+double calWallTime ()
+{return monotonicTime () - startTime;}
+
+double calTimeLeft (double deadline) {
+
+  if (deadline >= COIN_DBL_MAX)
+    return COIN_DBL_MAX;
+
+  return deadline - calWallTime ();
+}
+
+double calTimeSlice (double deadline, int nParts) {
+
+  double left = calTimeLeft (deadline);
+
+  if ((left >= COIN_DBL_MAX) || (nParts <= 1))
+    return left;
+
+  return left / nParts;
+}
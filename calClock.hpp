@@ -0,0 +1,37 @@
+/*
+ * optimal calibrated sampling -- wall-clock time and deadlines
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calClock_hpp
+#define calClock_hpp
+
+//
+// All time limits (options -t and -T) are in wall-clock seconds,
+// measured on a monotonic clock from the start of the program, so
+// that they also account for reading the instance and building the
+// model, and remain meaningful if parts of the code run in parallel.
+//
+// There is no global deadline: each instance has its own
+// (calInstance::deadline (), from -T or from calibri::Sampler), so
+// that several can be solved at once. Time slices are then handed
+// out top-down: each replication gets an equal share of the time
+// left (calModel::search), each BB run what is left of its
+// replication's share, capped by -t, and the nested BB of the Cube
+// heuristic what is left of the BB run that calls it.
+//
+
+/// seconds elapsed since the start of the program
+double calWallTime ();
+
+/// seconds left until deadline, a value of calWallTime (); COIN_DBL_MAX
+/// if deadline is COIN_DBL_MAX (none), may be negative
+double calTimeLeft (double deadline);
+
+/// seconds allotted to the next of nParts tasks sharing the time left
+/// until deadline, i.e., calTimeLeft (deadline) / nParts
+double calTimeSlice (double deadline, int nParts);
+
+#endif
@@ -16,62 +16,135 @@
 
 #include "OsiSolverInterface.hpp"
 #include "CbcModel.hpp"
+#include "CoinSort.hpp"
 
 #include "calInstance.hpp"
 #include "calCube.hpp"
+#include "calIterProj.hpp"
 #include "calModel.hpp"
+#include "calWeights.hpp"
+#include "calClock.hpp"
+#include "calProfile.hpp"
+#include "calTrace.hpp"
 
 //#define DEBUG
 
 // Default Constructor
 CalCubeHeur::CalCubeHeur (calInstance *inst): 
   CbcHeuristic (), 
-  noRun_    (false),
-  instance_ (inst),
-  calmodel_ (NULL) {}
+  noRun_       (false),
+  instance_    (inst),
+  calmodel_    (NULL),
+  weights_     (NULL),
+  nLightCalls_ (0),
+  nLightRuns_  (0),
+  nLightSucc_  (0),
+  lightTime_   (0.),
+  lightStart_  (calWallTime ()),
+  iterProj_    (NULL) {
+
+  selectProjection ();
+}
 
 // Constructor from model
 CalCubeHeur::CalCubeHeur (CbcModel & model): 
   CbcHeuristic (model),
-  noRun_    (false),
-  instance_ (NULL),
-  calmodel_ (NULL) {}
+  noRun_       (false),
+  instance_    (NULL),
+  calmodel_    (NULL),
+  weights_     (NULL),
+  nLightCalls_ (0),
+  nLightRuns_  (0),
+  nLightSucc_  (0),
+  lightTime_   (0.),
+  lightStart_  (calWallTime ()),
+  smallProject_ (NULL),
+  smallPP_      (0),
+  iterProj_     (NULL) {}
 
 // Destructor
-CalCubeHeur::~CalCubeHeur () {}
+CalCubeHeur::~CalCubeHeur () {
+
+  delete weights_;
+  delete iterProj_;
+}
 
-// Copy constructor
+// Copy constructor. Statistics of the light mode are not copied, as
+// each copy works in a new BB (cloned with its model right before the
+// BB starts), nor is the iterative projection (created by each copy)
 CalCubeHeur::CalCubeHeur (const CalCubeHeur & rhs): 
   CbcHeuristic (rhs), 
-  noRun_    (rhs.noRun_),
-  instance_ (rhs.instance_),
-  calmodel_ (rhs.calmodel_) {}
+  noRun_       (rhs.noRun_),
+  instance_    (rhs.instance_),
+  calmodel_    (rhs.calmodel_),
+  weights_     (NULL),
+  nLightCalls_ (0),
+  nLightRuns_  (0),
+  nLightSucc_  (0),
+  lightTime_   (0.),
+  lightStart_  (calWallTime ()),
+  smallProject_ (rhs.smallProject_),
+  smallPP_      (rhs.smallPP_),
+  iterProj_     (NULL) {}
 
 // Assignment operator
 CalCubeHeur &CalCubeHeur::operator= (const CalCubeHeur & rhs) {
 
-  CbcHeuristic::operator=(rhs);
-  noRun_    = rhs.noRun_;
-  instance_ = rhs.instance_;
-  calmodel_ = rhs.calmodel_;
+  if (this != &rhs) {
+
+    CbcHeuristic::operator=(rhs);
+    noRun_    = rhs.noRun_;
+    instance_ = rhs.instance_;
+    calmodel_ = rhs.calmodel_;
+
+    smallProject_ = rhs.smallProject_;
+    smallPP_      = rhs.smallPP_;
+
+    delete weights_;
+    delete iterProj_;
+
+    weights_     = NULL;
+    iterProj_    = NULL;
+    nLightCalls_ = nLightRuns_ = nLightSucc_ = 0;
+    lightTime_   = 0.;
+    lightStart_  = calWallTime ();
+  }
 
   return *this;
 }
 
 // set instance pointer (useful in constructor with CbcModel argument)
-void CalCubeHeur::setInstance (calInstance *inst) 
-{instance_ = inst;}
+void CalCubeHeur::setInstance (calInstance *inst) {
+
+  instance_ = inst;
+  selectProjection ();
+}
+
+// fixed-size projection for p+1 rows, once p is final (after
+// removing redundant calibration vectors). The iterative one is
+// created again for the new instance
+void CalCubeHeur::selectProjection () {
 
-extern bool      GLOBAL_interrupt;
-extern CbcModel *GLOBAL_curBB;
+  smallPP_      = instance_ ? 1 + instance_ -> p () : 0;
+  smallProject_ = instance_ ? calSelectProjection (smallPP_) : NULL;
+
+  delete iterProj_;
+  iterProj_ = NULL;
+}
 
 // Returns 1 if solution, 0 if not
 int CalCubeHeur::solution (double & solutionValue,
 			   double * betterSolution) {
 
-  if (noRun_ || GLOBAL_interrupt)
+  if (noRun_ || instance_ -> interrupted ())
     return 0;
 
+  if (instance_ -> lightCube ())
+    return lightShouldRun () ? lightSolution (solutionValue, betterSolution) : 0;
+
+  calProfTimer timer (instance_ -> profile (), PROF_CUBE_BB);
+  calTraceSpan span  ("cube nested BB", "found");
+
   calModel *b = calmodel_ -> clone ();
 
   OsiSolverInterface *si = b -> solver ();
@@ -89,9 +162,15 @@ int CalCubeHeur::solution (double & solutionValue,
 
   int N = instance_ -> N ();
 
+  // start from the (presolved) root bounds
+
+  const double
+    *rootLb = calmodel_ -> solver () -> getColLower (),
+    *rootUb = calmodel_ -> solver () -> getColUpper ();
+
   for (int i=0; i<N; ++i) {
-    si -> setColLower (1 + N + i, 0.);
-    si -> setColUpper (1 + N + i, 1.);
+    si -> setColLower (instance_ -> sCol (i), rootLb [instance_ -> sCol (i)]);
+    si -> setColUpper (instance_ -> sCol (i), rootUb [instance_ -> sCol (i)]);
   }
 
   // for (int i=0; i<N; ++i) {
@@ -110,7 +189,12 @@ int CalCubeHeur::solution (double & solutionValue,
 
   b -> messageHandler () -> setLogLevel (0);
 
-  GLOBAL_curBB = b;
+  // nested BB gets what is left of the calling one
+
+  calModel *parent = dynamic_cast <calModel *> (model_);
+
+  if (parent)
+    b -> deadline () = parent -> deadline ();
 
                            //    /|
                            //   / |--------+
@@ -118,8 +202,6 @@ int CalCubeHeur::solution (double & solutionValue,
                            //   \ |--------+
                            //    \|
 
-  GLOBAL_curBB = calmodel_;
-
   int retval = 0;
 
   if ((b -> bestObj () < 1e20) && (b -> bestSol ())) {
@@ -132,11 +214,112 @@ int CalCubeHeur::solution (double & solutionValue,
     retval = 1;
   } 
 
+  timer. count  (retval);
+  span.  setArg (retval);
+
   delete b;
 
   return retval;
 }
 
+// Light mode: run while the success rate, estimated as (1 + successes)
+// / (1 + runs) but never below LIGHT_MIN_SUCCESS, keeps up with the
+// fraction of calls run so far, and as long as the time spent here is
+// below LIGHT_TIME_FRAC of the BB time. Both times are wall clock, as
+// the BB deadline: CbcModel's own are CPU seconds
+bool CalCubeHeur::lightShouldRun () {
+
+  ++nLightCalls_;
+
+  if (!nLightRuns_)
+    return true;
+
+  if (lightTime_ > LIGHT_TIME_FRAC * (calWallTime () - lightStart_))
+    return false;
+
+  double rate = CoinMax (LIGHT_MIN_SUCCESS, (1. + nLightSucc_) / (1. + nLightRuns_));
+
+  return (nLightRuns_ < rate * nLightCalls_);
+}
+
+// Light mode: flight phase, landing by rounding the largest
+// fractional s to one, and optimal weights for the resulting sample
+int CalCubeHeur::lightSolution (double & solutionValue,
+				double * betterSolution) {
+
+  double startTime = calWallTime ();
+
+  calProfTimer timer (instance_ -> profile (), PROF_CUBE_LIGHT);
+  calTraceSpan span  ("cube light");
+
+  int
+    N = instance_ -> N (),
+    n = instance_ -> n ();
+
+  if (!weights_)
+    weights_ = new calWeights (instance_);
+
+  double
+    *s0    = generateInitS (*(model_ -> solver ())),
+    *key   = new double [N],
+    *delta = new double [N];
+
+  int *order = new int [N];
+
+  standalone (s0);  // call Cube method
+
+  // landing: keep the n units with largest s (ties broken at random)
+
+  for (int i=0; i<N; ++i) {
+    order [i] = i;
+    key   [i] = - s0 [i] - 1e-9 * instance_ -> random ();
+  }
+
+  CoinSort_2 (key, key + N, order);
+
+  CoinZeroN (s0, N);
+
+  for (int k=0; k<n; ++k)
+    s0 [order [k]] = 1.;
+
+  double f = weights_ -> solve (s0, delta);
+
+  int retval = 0;
+
+  if (f < solutionValue) {
+
+    CoinZeroN (betterSolution, model_ -> solver () -> getNumCols ());
+
+    betterSolution [0] = f;
+
+    if (!(instance_ -> benders ()))
+      CoinCopyN (delta, N, betterSolution + 1);
+
+    for (int i=0; i<N; ++i)
+      betterSolution [instance_ -> sCol (i)] = s0 [i];
+
+    solutionValue = f;
+    retval = 1;
+    ++nLightSucc_;
+  }
+
+  timer. count (retval);
+
+#ifdef DEBUG
+  printf ("light Cube: %g (%d/%d successful)\n", f, nLightSucc_, 1 + nLightRuns_);
+#endif
+
+  ++nLightRuns_;
+  lightTime_ += calWallTime () - startTime;
+
+  delete [] s0;
+  delete [] key;
+  delete [] delta;
+  delete [] order;
+
+  return retval;
+}
+
 // generate initial point on subspace described by calibration vectors
 double *CalCubeHeur::generateInitS (OsiSolverInterface &si) {
 
@@ -169,7 +352,7 @@ double *CalCubeHeur::generateInitS (OsiSolverInterface &si) {
 
       for (int i=0; i<n;) {
 
-	int pos = (int) (drand48 () * ((double) N - 1e-5));
+	int pos = (int) (instance_ -> random () * ((double) N - 1e-5));
 
 	if (fabs (maj - s00 [pos]) < .45) { // unfixed just yet
 	  s00 [pos] = 1 - maj;
@@ -204,3 +387,41 @@ double *CalCubeHeur::generateInitS (OsiSolverInterface &si) {
 
   return s00;
 }
+
+// average of s over nRuns flight phases started at n/N, used as
+// inclusion frequency of each unit
+double *CalCubeHeur::inclusionFrequencies (int nRuns) {
+
+  int N = instance_ -> N ();
+
+  double
+    *freq = new double [N],
+    *s0   = new double [N];
+
+  CoinZeroN (freq, N);
+
+  int run = 0;
+
+  for (; (run < nRuns) && !(instance_ -> interrupted ()); ++run) {
+
+    CoinFillN (s0, N, (double) instance_ -> n () / N);
+
+    standalone (s0);
+
+    for (int i=0; i<N; ++i)
+      freq [i] += s0 [i];
+  }
+
+  if (run)
+    for (int i=0; i<N; ++i)
+      freq [i] /= run;
+  else CoinFillN (freq, N, (double) instance_ -> n () / N);
+
+#ifdef DEBUG
+  printVec (freq, N, "frequencies");
+#endif
+
+  delete [] s0;
+
+  return freq;
+}
@@ -20,6 +20,9 @@
 
 #include "calInstance.hpp"
 #include "calCube.hpp"
+#include "calIterProj.hpp"
+#include "calProfile.hpp"
+#include "calSimd.hpp"
 
 #define F77_FUNC(lcase, UCASE) lcase ## _
 
@@ -102,6 +105,8 @@ void CalCubeHeur::project (double *v, double *u, double *pi) {
 
   // Note: selective filling of A is in for loop for LQ decomposition
 
+  calProfTimer timer (instance_ -> profile (), PROF_PROJECT);
+
   // LQ decomposition of A //////////////////////////////////////////////////
 
   int
@@ -111,11 +116,34 @@ void CalCubeHeur::project (double *v, double *u, double *pi) {
     lwork = N, 
     info;
 
+  if ((instance_ -> iterProjection () > 0) &&
+      (p >= instance_ -> iterProjection ())) { // many rows: see calIterProj.hpp
+
+    if (!iterProj_)
+      iterProj_ = new calIterProj (instance_);
+
+    int nIter = iterProj_ -> project (v, u, pi);
+
+    if (nIter >= 0) {
+      timer. count (nIter);
+      return;
+    }
+
+    // not converged: use the projections below
+  }
+
+  if (smallProject_ && (smallPP_ == pp)) { // few rows: see calCube-small.cpp
+    smallProject_ (instance_, v, u, pi);
+    return;
+  }
+
   double
     *A    = new double [pp * N],
     *tau  = new double      [N],
     *work = new double      [N];
 
+  calProfTimer fillTimer (instance_ -> profile (), PROF_VECTOR);
+
   CoinZeroN (A, pp*N);
 
 #ifdef DEBUG
@@ -150,10 +178,16 @@ void CalCubeHeur::project (double *v, double *u, double *pi) {
   printMatr (A, pp, N, "A");
 #endif
 
+  fillTimer. stop ();
+
+  calProfTimer lqTimer (instance_ -> profile (), PROF_LQ);
+
   F77_FUNC           // <------------------------- LQ call
     (dgelqf,DGELQF)
     (&pp, &N, A, &pp, tau, work, &lwork, &info);
 
+  lqTimer. stop ();
+
   //printMatr (A, pp, N, "LQ");
 
   double *L = new double [pp * pp];
@@ -173,10 +207,14 @@ void CalCubeHeur::project (double *v, double *u, double *pi) {
   //printMatr (L, pp, pp, "L");
   //printMatr (A, pp, N,  "A");
 
+  calProfTimer orglqTimer (instance_ -> profile (), PROF_ORGLQ);
+
   F77_FUNC
     (dorglq,DORGLQ)
     (&pp, &N, &pp, A, &pp, tau, work, &lwork, &info);
 
+  orglqTimer. stop ();
+
   delete [] tau; // passed between LQ decomp (dgekqf) and
 		 // reflectors_to_Q (dorglq), we don't care about it
 
@@ -215,6 +253,8 @@ void CalCubeHeur::project (double *v, double *u, double *pi) {
 
   lwork = -1;
 
+  calProfTimer svdTimer (instance_ -> profile (), PROF_SVD);
+
   double *Lcopy = CoinCopyOfArray (L, pp * pp);
 
   F77_FUNC           // <------------------------- SVD dry call: just get the right lwork
@@ -231,6 +271,8 @@ void CalCubeHeur::project (double *v, double *u, double *pi) {
 
   delete [] work;
 
+  svdTimer. stop ();
+
   //printMatr (U,  pp, pp, "U");
   //printMatr (VT, pp, pp, "Vt");
   //printVec  (S,  pp,     "S");
@@ -270,27 +312,20 @@ void CalCubeHeur::project (double *v, double *u, double *pi) {
   // Compute it backwards since v is a vector. Complexity is O(pN+p^2) = O(pN) since p<<N
   //
 
-  double *Av = new double [pp];
+  calProfTimer vectorTimer (instance_ -> profile (), PROF_VECTOR);
 
-  CoinZeroN (Av, pp);
+  double *Av = new double [pp];
 
   // <------------------------ Compute A*v
+  //
+  // No need to check if pi [ind] is fractional: when filling A above,
+  // v [ind] was zeroed for all ind of X where it is not
 
   for (int i=0; i<pp; ++i) {
 
     CoinPackedVector *x = instance_ -> X () [i];
 
-    double *elements = x -> getElements    ();
-    int    *indices  = x -> getIndices     (),
-      numEl          = x -> getNumElements ();
-
-    for (int j=0; j<numEl; ++j) {
-
-      int ind = indices [j];
-
-      if (fabs (pi [ind] - .5) < (.5 - 1e-5)) // this means that pi [ind] is fractional
-	Av [i] += elements [j] * v [ind];
-    }
+    Av [i] = calSimd () -> sparseDot (x -> getElements (), x -> getIndices (), x -> getNumElements (), v);
   }
 
   //printVec (Av, pp, "A*v");
@@ -330,15 +365,7 @@ void CalCubeHeur::project (double *v, double *u, double *pi) {
 
   // <------------------------ Pre-multiply (VT'*Sinv*)UtAv by [Q_11,Q_12]' to obtain u
 
-  //  CoinZeroN (u, N);
-
-  for   (int i=0; i<N; ++i) {
-
-    double &ucurr = u [i] = v [i];
-
-    for (int j=0; j<pp; ++j)
-      ucurr -= Q [i*pp + j] * VUtAv [j];
-  }
+  calSimd () -> subGemv (Q, pp, N, VUtAv, v, u);
 
 #ifdef DEBUG
   {
@@ -0,0 +1,260 @@
+/*
+ * optimal calibrated sampling -- Cube heuristic (Tillé and De Ville),
+ * projection for few calibration vectors
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#if defined(_MSC_VER)
+// Turn off compiler warning about long names
+#  pragma warning(disable:4786)
+#endif
+
+#include <cmath>
+
+#include "CoinHelperFunctions.hpp"
+#include "CoinPackedVector.hpp"
+
+#include "calInstance.hpp"
+#include "calCube.hpp"
+
+#define SMALL_JACOBI_SWEEPS 50    // max sweeps of the eigenvalue method
+#define SMALL_EIG_TOL       1e-12 // eigenvalues below this times the largest are zero
+
+//
+// Same projection as in calCube-project.cpp, for a number PP = p+1 of
+// rows of A known at compile time. When PP is small, calling LAPACK
+// (with a workspace query every time) and loops with a variable bound
+// cost more than the arithmetic, so here
+//
+// 1) fill A and v as in project ()
+// 2) G = A*A' and b = A*v, in one pass over the columns of A
+// 3) (Lambda, E) <- eigenvalues and vectors of G, by Jacobi's method
+// 4) u = v - A' * G^+ * b, with G^+ = E * inv (Lambda) * E', where
+//    eigenvalues near zero (A without full row rank) are left out
+// 5) as G squares the condition number of A, correct u once:
+//    u = u - A' * G^+ * A * u
+//
+
+// eigenvalues lambda and eigenvectors (columns of E, by rows) of the
+// symmetric matrix G, which is overwritten
+
+template <int PP> static void symEigen (double *G, double *lambda, double *E) {
+
+  for   (int i=0; i<PP; ++i)
+    for (int j=0; j<PP; ++j)
+      E [i*PP + j] = (i==j) ? 1. : 0.;
+
+  for (int sweep = 0; sweep < SMALL_JACOBI_SWEEPS; ++sweep) {
+
+    double off = 0., diag = 0.;
+
+    for (int i=0; i<PP; ++i) {
+      diag += G [i*PP + i] * G [i*PP + i];
+      for (int j=i+1; j<PP; ++j)
+	off += G [i*PP + j] * G [i*PP + j];
+    }
+
+    if (off <= 1e-30 * diag)
+      break;
+
+    for   (int p=0;   p<PP; ++p)
+      for (int q=p+1; q<PP; ++q) {
+
+	double gpq = G [p*PP + q];
+
+	if (fabs (gpq) < 1e-300)
+	  continue;
+
+	// rotation that zeroes G [p,q]
+
+	double
+	  theta = (G [q*PP + q] - G [p*PP + p]) / (2. * gpq),
+	  t     = ((theta >= 0.) ? 1. : -1.) / (fabs (theta) + sqrt (theta * theta + 1.)),
+	  c     = 1. / sqrt (t * t + 1.),
+	  s     = t * c;
+
+	G [p*PP + p] -= t * gpq;
+	G [q*PP + q] += t * gpq;
+	G [p*PP + q] = G [q*PP + p] = 0.;
+
+	for (int k=0; k<PP; ++k) {
+
+	  if ((k != p) && (k != q)) {
+
+	    double
+	      gkp = G [k*PP + p],
+	      gkq = G [k*PP + q];
+
+	    G [k*PP + p] = G [p*PP + k] = c * gkp - s * gkq;
+	    G [k*PP + q] = G [q*PP + k] = s * gkp + c * gkq;
+	  }
+
+	  double
+	    ekp = E [k*PP + p],
+	    ekq = E [k*PP + q];
+
+	  E [k*PP + p] = c * ekp - s * ekq;
+	  E [k*PP + q] = s * ekp + c * ekq;
+	}
+      }
+  }
+
+  for (int i=0; i<PP; ++i)
+    lambda [i] = G [i*PP + i];
+}
+
+// y = G^+ * b, with G = E * diag (lambda) * E'
+
+template <int PP> static void pseudoSolve (const double *lambda, const double *E, const double *b, double *y) {
+
+  double lMax = 0.;
+
+  for (int k=0; k<PP; ++k)
+    if (lambda [k] > lMax)
+      lMax = lambda [k];
+
+  for (int i=0; i<PP; ++i)
+    y [i] = 0.;
+
+  for (int k=0; k<PP; ++k) {
+
+    if (lambda [k] <= SMALL_EIG_TOL * lMax)
+      continue;
+
+    double coeff = 0.;
+
+    for (int i=0; i<PP; ++i)
+      coeff += E [i*PP + k] * b [i];
+
+    coeff /= lambda [k];
+
+    for (int i=0; i<PP; ++i)
+      y [i] += coeff * E [i*PP + k];
+  }
+}
+
+template <int PP> static void projectSmall (calInstance *instance, double *v, double *u, const double *pi) {
+
+  int N = instance -> N ();
+
+  double *A = new double [PP * N];
+
+  CoinZeroN (A, PP * N);
+
+  // 1) fill A, zero v where pi is integer
+
+  for (int i=0; i<PP; ++i) {
+
+    CoinPackedVector *x = instance -> X () [i];
+
+    const double *elements = x -> getElements    ();
+    const int    *indices  = x -> getIndices     ();
+    int           numEl    = x -> getNumElements ();
+
+    for (int j=0; j<numEl; ++j) {
+
+      int ind = indices [j];
+
+      if (fabs (pi [ind] - .5) < (.5 - 1e-5)) // this means that pi [ind] is fractional
+	A [ind*PP + i] = elements [j];
+      else v [ind] = 0;
+    }
+  }
+
+  // 2) G = A*A' (upper triangle) and b = A*v
+
+  double G [PP*PP], b [PP];
+
+  for (int i=0; i<PP*PP; ++i) G [i] = 0.;
+  for (int i=0; i<PP;    ++i) b [i] = 0.;
+
+  for (int c=0; c<N; ++c) {
+
+    const double *a = A + c*PP;
+
+    for (int i=0; i<PP; ++i) {
+
+      b [i] += a [i] * v [c];
+
+      for (int j=i; j<PP; ++j)
+	G [i*PP + j] += a [i] * a [j];
+    }
+  }
+
+  for   (int i=0; i<PP; ++i)
+    for (int j=0; j<i;  ++j)
+      G [i*PP + j] = G [j*PP + i];
+
+  // 3) G = E * Lambda * E'
+
+  double lambda [PP], E [PP*PP], y [PP];
+
+  symEigen <PP> (G, lambda, E);
+
+  // 4) u = v - A' * G^+ * b
+
+  pseudoSolve <PP> (lambda, E, b, y);
+
+  for (int c=0; c<N; ++c) {
+
+    const double *a = A + c*PP;
+
+    double uc = v [c];
+
+    for (int i=0; i<PP; ++i)
+      uc -= a [i] * y [i];
+
+    u [c] = uc;
+  }
+
+  // 5) one correction: b = A*u, which should be zero
+
+  for (int i=0; i<PP; ++i)
+    b [i] = 0.;
+
+  for (int c=0; c<N; ++c) {
+
+    const double *a = A + c*PP;
+
+    for (int i=0; i<PP; ++i)
+      b [i] += a [i] * u [c];
+  }
+
+  pseudoSolve <PP> (lambda, E, b, y);
+
+  for (int c=0; c<N; ++c) {
+
+    const double *a = A + c*PP;
+
+    for (int i=0; i<PP; ++i)
+      u [c] -= a [i] * y [i];
+  }
+
+  delete [] A;
+}
+
+calSmallProjection calSelectProjection (int pp) {
+
+  switch (pp) {
+
+  case  2: return projectSmall  <2>;
+  case  3: return projectSmall  <3>;
+  case  4: return projectSmall  <4>;
+  case  5: return projectSmall  <5>;
+  case  6: return projectSmall  <6>;
+  case  7: return projectSmall  <7>;
+  case  8: return projectSmall  <8>;
+  case  9: return projectSmall  <9>;
+  case 10: return projectSmall <10>;
+  case 11: return projectSmall <11>;
+  case 12: return projectSmall <12>;
+  case 13: return projectSmall <13>;
+  case 14: return projectSmall <14>;
+  case 15: return projectSmall <15>;
+  case 16: return projectSmall <16>;
+
+  default: return NULL;
+  }
+}
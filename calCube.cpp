@@ -23,8 +23,9 @@
 
 #include "calInstance.hpp"
 #include "calCube.hpp"
-
-extern bool GLOBAL_interrupt;
+#include "calProfile.hpp"
+#include "calTrace.hpp"
+#include "calSimd.hpp"
 
 // cube method -- standalone: does not set all s to one or zero
 void CalCubeHeur::standalone (double *s0) {
@@ -47,13 +48,19 @@ void CalCubeHeur::standalone (double *s0) {
     *v  = new double [N],
     *u  = new double [N];
 
-  for (int iter = 0; !GLOBAL_interrupt; ++iter) {
+  calProfTimer timer (instance_ -> profile (), PROF_FLIGHT);
+  calTraceSpan span  ("flight phase", "iterations");
+
+  for (int iter = 0; !(instance_ -> interrupted ()); ++iter) {
+
+    timer. count (1);
+    span.  setArg (1 + iter);
 
     //printf ("iteration %d: ", iter);
 
     // generate v
     for (int i=N; i--;)
-      v [i] = -1 + 2 * drand48 (); // returns random vector in [-1,1]^N
+      v [i] = -1 + 2 * instance_ -> random (); // returns random vector in [-1,1]^N
 
     // Better generator: generate random point on unit sphere
 
@@ -62,12 +69,12 @@ void CalCubeHeur::standalone (double *s0) {
     for (int i=N; --i;) {
 
       // angle generated uniformly in [-pi/2,pi/2]
-      register double alpha = -M_PI / 2. + M_PI * drand48 ();
+      register double alpha = -M_PI / 2. + M_PI * instance_ -> random ();
       v [i] = cos_seq * sin (alpha);
       cos_seq *=        cos (alpha);
     }
 
-    v [0] = cos_seq * ((drand48 () < .5) ? -1. : 1.);
+    v [0] = cos_seq * ((instance_ -> random () < .5) ? -1. : 1.);
 
     //printVec (s0,N,"s0");
     //printVec (v, N,"random v");
@@ -91,23 +98,12 @@ void CalCubeHeur::standalone (double *s0) {
       lambdaM = COIN_DBL_MAX,
       lambdaP = COIN_DBL_MAX;
 
-    for (int i=0; i < N; ++i) 
-
-      if (fabs (u [i]) > 1e-6) {
-
-	lambdaM = CoinMin (lambdaM, 
-			   u [i] > 0 ?      s0 [i]  / u [i] : 
-			   u [i] < 0 ? (1 - s0 [i]) / u [i] : lambdaM);
-
-	lambdaP = CoinMin (lambdaP, 
-			   u [i] > 0 ? (1 - s0 [i]) / u [i] : 
-			   u [i] < 0 ?    - s0 [i]  / u [i] : lambdaP);
-      }
+    calSimd () -> ratioTest (s0, u, N, 1e-6, &lambdaM, &lambdaP);
 
     // now modify s0: up with probability lambdaM / (lambdaM + lambdaP), down otherwise //////
 
-    if (drand48 () < lambdaM / (lambdaM + lambdaP)) for (int i=N; i--;) s0 [i] += lambdaP * u [i]; // move up
-    else                                            for (int i=N; i--;)	s0 [i] -= lambdaM * u [i]; // move down
+    if (instance_ -> random () < lambdaM / (lambdaM + lambdaP)) calSimd () -> axpy ( lambdaP, u, s0, N); // move up
+    else                                                        calSimd () -> axpy (-lambdaM, u, s0, N); // move down
 
     //printVec (s0, N, "\n\ns");
   }
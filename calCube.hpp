@@ -8,15 +8,22 @@
 #ifndef calCube_H
 #define calCube_H
 
-#ifdef WIN32
-#define srand48(a) srand((a))
-#define drand48() ((double)rand()/RAND_MAX)
-#endif
-
 #include "CbcHeuristic.hpp"
 
 class calInstance;
 class calModel;
+class calWeights;
+class calIterProj;
+
+#define LIGHT_MIN_SUCCESS .05 // run light heuristic at least once every 1/this calls
+#define LIGHT_TIME_FRAC   .1  // max fraction of BB time spent in light heuristic
+
+/// projection for a given number p+1 of rows, of fixed size (see
+/// calCube-small.cpp)
+typedef void (*calSmallProjection) (calInstance *instance, double *v, double *u, const double *pi);
+
+/// the one for pp rows if 2 <= pp <= 16, otherwise NULL
+calSmallProjection calSelectProjection (int pp);
 
 //
 // Heuristic to run a variant of the Cube algorithm
@@ -76,6 +83,9 @@ public:
   // cube method -- standalone: does not set all s to one or zero
   void standalone (double *s00);
 
+  // average of s over nRuns flight phases started at n/N
+  double *inclusionFrequencies (int nRuns);
+
   void setCalModel (calModel *m)
   {calmodel_ = m;}
 
@@ -89,9 +99,33 @@ protected:
   calInstance *instance_;
   calModel    *calmodel_;
 
+  // light mode (option -l): flight phase, landing by rounding, and
+  // weights from calWeights, with no nested branch-and-bound
+
+  calWeights *weights_;      ///< created at first light call
+  int         nLightCalls_;  ///< calls received (run or skipped)
+  int         nLightRuns_;   ///< runs
+  int         nLightSucc_;   ///< runs that improved the incumbent
+  double      lightTime_;    ///< time spent in runs (wall clock)
+  double      lightStart_;   ///< calWallTime () at creation, i.e., when its BB began
+
+  bool lightShouldRun ();    ///< schedule by success rate and time
+  int  lightSolution  (double &objectiveValue, double *newSolution);
+
   // project v on null space of restricted calibration constraints. If
   // pi=NULL, taken to be with all elements not in {0,1}
   void project (double *v, double *u, double *pi = NULL);
+
+  // fixed-size projection for the p of the instance, if any, chosen
+  // with the instance
+  calSmallProjection smallProject_;
+  int                smallPP_;      ///< p+1 it was chosen for
+
+  // iterative projection for large p (option -I), created at first
+  // use as it keeps its preconditioner between calls
+  calIterProj       *iterProj_;
+
+  void selectProjection ();
 };
 
 //
@@ -7,6 +7,9 @@
 
 #include "calCut.hpp"
 #include "calCube.hpp"
+#include "calProfile.hpp"
+#include "calTrace.hpp"
+#include "calSimd.hpp"
 
 #define MIN_VIOLATION 1e-5
 #define maxCallsPerNode 30
@@ -20,8 +23,6 @@ void calCut::generateCuts (const OsiSolverInterface & si,
 			   OsiCuts & cs,
 			   const CglTreeInfo info) const {
 
-  static int ncuts = 0;
-
   // These cuts aim at approximating a cone function that is
   // expressed, through an inequality of the form z >= || delta ||_2
   //
@@ -41,11 +42,13 @@ void calCut::generateCuts (const OsiSolverInterface & si,
   // objective function, which is not very accurate at the beginning
   // due to the polyhedral conic approximation.
 
+  calProfTimer timer (instance_ -> profile (), PROF_CUT);
+  calTraceSpan span  ("cut round", "pass", info.pass);
+
   int 
     N = instance_ -> N ();
 
   double 
-    sumDeltaSq = 0.,
     zCurrent  = si. getColSolution () [0];     // value of z, first variable and objective function
 
   const double *dCurrent = si. getColSolution () + 1; // pointer to first element of the delta subvector
@@ -54,15 +57,10 @@ void calCut::generateCuts (const OsiSolverInterface & si,
 	
   //  CoinPackedVector xs (si. getNumCols (), si. getColSolution());
 
-  // check if cut violated
+  // check if cut violated. Can't stop at threshold! z's coeff won't
+  // be correct
 
-  for (int i=0; i<N; ++i) {
-    sumDeltaSq += dCurrent [i] * dCurrent [i];
-
-    // can't stop at threshold! z's coeff won't be correct
-    //if (sumDeltaSq > zCurrent)
-    //  break;
-  }
+  double sumDeltaSq = calSimd () -> sumSq (dCurrent, N);
 
   if (sumDeltaSq <= zCurrent) // no cuts to separate
     return;
@@ -126,12 +124,11 @@ void calCut::generateCuts (const OsiSolverInterface & si,
 #endif
 
   cs.insert (cut);
+  timer. count (1);
   
   delete cut;
   delete [] indices;
   delete [] coeff;
 
-  ++ncuts;
-
   // printf ("->  %d %d %d %g\r", nodeNum, ncalls, ncuts, cur_obj);
 }
@@ -0,0 +1,443 @@
+/*
+ * optimal calibrated sampling -- daemon mode
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <map>
+
+#ifndef _MSC_VER
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include <OsiClpSolverInterface.hpp>
+#include <CoinFinite.hpp>
+
+#include "calInstance.hpp"
+#include "calOutput.hpp"
+#include "calClock.hpp"
+
+//
+// Daemon mode (option -U): the instances given on the command line
+// are read once and kept in memory, together with the root MILP built
+// for each sample size requested so far, and requests are served on a
+// Unix socket, one connection at a time. Each request is a line
+//
+//   <key> <n> [<seed> [<replications> [<seconds>]]]
+//
+// where key is an instance file name as given on the command line.
+// Missing or negative seed: the instance's seed plus the number of
+// requests served; missing or nonpositive replications and seconds:
+// those of the instance (-R, -T). The reply is one line
+//
+//   sample <replication> <||w-d||^2> <id>:<weight> ... (n pairs)
+//
+// for each replication with a sample, as soon as it is found,
+// followed by
+//
+//   done <# samples> <seconds> <seed>
+//
+// or by "error <message>". A line "quit" closes the connection, and
+// "shutdown" also stops the daemon. A request is abandoned, at the
+// next BB node, when its client closes the connection (a client that
+// only shuts down its writing side still gets the reply) or when the
+// daemon is interrupted: a watcher thread polls the socket and the
+// stop flag while the request runs. Waits for connections and
+// requests also poll, so that an interrupt is seen even if the signal
+// restarts accept () and recv ().
+//
+
+#define DAEMON_MAX_LINE 4096 // longest request
+#define DAEMON_BACKLOG  8    // pending connections
+#define DAEMON_POLL_MS  200  // how often to look at the stop flag and the client
+
+void calBuildRoot (calInstance *instance, OsiClpSolverInterface &model);
+int  calSolve     (calInstance *instance, calOutput *out, const OsiClpSolverInterface *root);
+
+#ifndef _MSC_VER
+
+static bool sendAll (int fd, const char *data, int size) {
+
+  while (size > 0) {
+
+    ssize_t k = send (fd, data, size, MSG_NOSIGNAL);
+
+    if (k < 0) {
+      if (errno == EINTR)
+	continue;
+      return false;
+    }
+
+    data += k;
+    size -= (int) k;
+  }
+
+  return true;
+}
+
+static bool reply (int fd, const char *msg)
+{return sendAll (fd, msg, (int) strlen (msg));}
+
+// wait up to DAEMON_POLL_MS for fd to be readable. Returns 1 if it
+// is, 0 if not (or interrupted by a signal), -1 on error
+
+static int waitReadable (int fd) {
+
+  struct pollfd pfd;
+
+  pfd.fd      = fd;
+  pfd.events  = POLLIN;
+  pfd.revents = 0;
+
+  int k = poll (&pfd, 1, DAEMON_POLL_MS);
+
+  if (k < 0)
+    return (errno == EINTR) ? 0 : -1;
+
+  return (k > 0) ? 1 : 0;
+}
+
+//
+// Watches a request while it runs: sets cancel if the client closes
+// the connection (POLLHUP, not set by a shutdown of its writing side
+// only) or if stop is set
+//
+
+struct calWatch {
+
+  int                  fd;
+  const volatile bool *stop;
+  volatile bool        cancel;  ///< the instance's cancellation flag
+  volatile bool        gone;    ///< client disconnected
+  volatile bool        done;    ///< request finished: watcher exits
+};
+
+extern "C" {
+
+  static void *watchRequest (void *arg) {
+
+    calWatch *w = (calWatch *) arg;
+
+    struct pollfd pfd;
+
+    pfd.fd     = w -> fd;
+    pfd.events = 0; // POLLHUP and POLLERR are always reported
+
+    while (!(w -> done)) {
+
+      pfd.revents = 0;
+
+      if ((poll (&pfd, 1, DAEMON_POLL_MS) > 0) &&
+	  (pfd.revents & (POLLHUP | POLLERR | POLLNVAL))) {
+	w -> gone = w -> cancel = true;
+	break;
+      }
+
+      if (*(w -> stop)) {
+	w -> cancel = true;
+	break;
+      }
+    }
+
+    return NULL;
+  }
+}
+
+//
+// Sends each sample to the client as soon as it is found
+//
+
+class calSocketOutput: public calOutput {
+
+protected:
+
+  int       fd_;
+  calWatch *watch_; ///< marked gone if a send fails, which cancels the request
+
+public:
+
+  calSocketOutput (calInstance *inst, int fd, calWatch *watch):
+    calOutput (inst),
+    fd_       (fd),
+    watch_    (watch) {}
+
+  void writeHeader () {}
+
+  void writeSample (int repl, double obj, const double *sol) {
+
+    int N = instance_ -> N ();
+
+    double w0 = (double) N / instance_ -> n ();
+
+    calOutBuffer *buf = buffer ();
+
+    buf -> putString ("sample ");
+    buf -> putInt    (1 + repl);
+    buf -> putChar   (' ');
+    buf -> putDouble (obj);
+
+    for (int i=0; i<N; ++i)
+      if (fabs (sol [1 + N + i]) > 1e-6) {
+
+	buf -> putChar (' ');
+
+	if (instance_ -> id (i)) buf -> putString (instance_ -> id (i));
+	else                     buf -> putInt    (1+i);
+
+	buf -> putChar   (':');
+	buf -> putDouble (w0 + sol [1 + i]);
+      }
+
+    buf -> putChar ('\n');
+
+    if (!sendAll (fd_, buf -> data (), buf -> size ()))
+      watch_ -> gone = watch_ -> cancel = true;
+
+    submit (buf); // no file: just recycled
+  }
+};
+
+//
+// Serve one request. Returns false if the client is gone
+//
+
+static bool request (int fd, char *line, calInstance **instances, int nInstances,
+		     std::map <int, OsiClpSolverInterface *> *roots, int nServed,
+		     const volatile bool *stop) {
+
+  char   key [DAEMON_MAX_LINE];
+  int    n, seed = -1, nRepl = 0;
+  double seconds = 0.;
+
+  if (sscanf (line, "%s %d %d %d %lf", key, &n, &seed, &nRepl, &seconds) < 2)
+    return reply (fd, "error usage: <key> <n> [<seed> [<replications> [<seconds>]]]\n");
+
+  int k = 0;
+
+  while ((k < nInstances) && (instances [k] -> name () != key))
+    ++k;
+
+  if (k == nInstances)
+    return reply (fd, "error unknown instance\n");
+
+  calInstance *inst = instances [k];
+
+  if ((n < 1) || (n >= inst -> N ()))
+    return reply (fd, "error sample size must be in [1,N-1]\n");
+
+  // root MILP for this n, built once
+
+  inst -> setSampleSize (n);
+
+  OsiClpSolverInterface *&root = roots [k] [n];
+
+  if (!root) {
+    root = new OsiClpSolverInterface;
+    calBuildRoot (inst, *root);
+  }
+
+  // request's options, restored afterwards
+
+  int
+    oldSeed  = inst -> randSeed      (),
+    oldRepl  = inst -> nReplications ();
+
+  double start = calWallTime ();
+
+  calWatch watch;
+
+  watch.fd     = fd;
+  watch.stop   = stop;
+  watch.cancel = false;
+  watch.gone   = false;
+  watch.done   = false;
+
+  pthread_t watcher;
+
+  bool watching = (0 == pthread_create (&watcher, NULL, watchRequest, &watch));
+
+  inst -> randSeed      () = (seed  >= 0) ? seed  : oldSeed + nServed;
+  inst -> nReplications () = (nRepl >  0) ? nRepl : oldRepl;
+  inst -> deadline      () =
+    (seconds > 0.)                 ? start + seconds :
+    (inst -> maxTotalTime () >= 0) ? start + inst -> maxTotalTime () : COIN_DBL_MAX;
+  inst -> cancelFlag    () = &watch.cancel; // without a watcher, set only by a failed send
+
+  calSocketOutput out (inst, fd, &watch);
+
+  int nSamples = calSolve (inst, &out, root);
+
+  watch.done = true;
+
+  if (watching)
+    pthread_join (watcher, NULL);
+
+  seed = inst -> randSeed ();
+
+  inst -> randSeed      () = oldSeed;
+  inst -> nReplications () = oldRepl;
+  inst -> deadline      () = COIN_DBL_MAX;
+  inst -> cancelFlag    () = NULL;
+
+  if (watch.gone)
+    return false;
+
+  if (watch.cancel) { // interrupted
+    reply (fd, "error interrupted\n");
+    return false;
+  }
+
+  char done [100];
+  sprintf (done, "done %d %g %d\n", nSamples, calWallTime () - start, seed);
+
+  return reply (fd, done);
+}
+
+#endif
+
+int calDaemon (const char *path, calInstance **instances, int nInstances, const volatile bool *stop) {
+
+#ifdef _MSC_VER
+
+  printf ("Error: daemon mode needs Unix domain sockets, not available on this platform\n");
+  return -1;
+
+#else
+
+  struct sockaddr_un addr;
+
+  if (strlen (path) >= sizeof (addr.sun_path)) {
+    printf ("Error: socket path %s too long\n", path);
+    return -1;
+  }
+
+  for (int k=0; k<nInstances; ++k) {
+
+    if (!(instances [k] -> noPresolve ())) {
+
+      int nRemoved = instances [k] -> removeRedundantX ();
+
+      if (nRemoved)
+	printf ("%s: removed %d redundant calibration vector(s)\n", instances [k] -> name (). c_str (), nRemoved);
+    }
+
+    instances [k] -> quiet () = true;
+    instances [k] -> print ();
+  }
+
+  int sock = socket (AF_UNIX, SOCK_STREAM, 0);
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, sizeof (addr.sun_path), path);
+
+  unlink (path);
+
+  if ((sock < 0) ||
+      (bind   (sock, (struct sockaddr *) &addr, sizeof (addr)) < 0) ||
+      (listen (sock, DAEMON_BACKLOG) < 0)) {
+
+    perror ("Error: cannot listen on socket");
+    if (sock >= 0)
+      close (sock);
+    return -1;
+  }
+
+  printf ("Serving %d instance(s) on %s\n", nInstances, path); fflush (stdout);
+
+  std::map <int, OsiClpSolverInterface *> *roots = new std::map <int, OsiClpSolverInterface *> [nInstances];
+
+  bool shutdown = false;
+
+  int nServed = 0;
+
+  while (!shutdown && !*stop) {
+
+    int ready = waitReadable (sock);
+
+    if (ready < 0) {
+      perror ("Error: poll");
+      break;
+    }
+
+    if (!ready)
+      continue;
+
+    int fd = accept (sock, NULL, NULL);
+
+    if (fd < 0) {
+      if (errno == EINTR)
+	continue;
+      perror ("Error: accept");
+      break;
+    }
+
+    char line [DAEMON_MAX_LINE];
+    int  len = 0;
+
+    for (bool connected = true; connected && !shutdown && !*stop;) {
+
+      char *eol = (char *) memchr (line, '\n', len);
+
+      if (!eol) {
+
+	if (len == DAEMON_MAX_LINE) {
+	  reply (fd, "error request too long\n");
+	  break;
+	}
+
+	int ready = waitReadable (fd);
+
+	if (ready <  0) break;
+	if (ready == 0) continue;
+
+	ssize_t k = recv (fd, line + len, DAEMON_MAX_LINE - len, 0);
+
+	if (k < 0 && errno == EINTR) continue;
+	if (k <= 0)                  break;
+
+	len += (int) k;
+	continue;
+      }
+
+      *eol = 0;
+
+      if (eol > line && eol [-1] == '\r')
+	eol [-1] = 0;
+
+      if      (!strcmp (line, "quit"))     connected = false;
+      else if (!strcmp (line, "shutdown")) shutdown  = true;
+      else if (*line)                      connected = request (fd, line, instances, nInstances, roots, nServed++, stop);
+
+      len -= (int) (eol + 1 - line);
+      memmove (line, eol + 1, len);
+    }
+
+    close (fd);
+  }
+
+  close  (sock);
+  unlink (path);
+
+  for (int k=0; k<nInstances; ++k)
+    for (std::map <int, OsiClpSolverInterface *>::iterator i = roots [k]. begin (); i != roots [k]. end (); ++i)
+      delete i -> second;
+
+  delete [] roots;
+
+  printf ("Daemon stopped after %d request(s)\n", nServed);
+
+  return 0;
+
+#endif
+}
@@ -0,0 +1,50 @@
+/*
+ * optimal calibrated sampling -- event handler
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include "calEvent.hpp"
+#include "calModel.hpp"
+#include "calInstance.hpp"
+#include "calClock.hpp"
+
+//#define DEBUG
+
+CbcEventHandler::CbcAction calEventHandler::event (CbcEvent whichEvent) {
+
+  if ((whichEvent != solution)          &&
+      (whichEvent != heuristicSolution) &&
+      (whichEvent != node))
+    return noAction;
+
+  calModel *model = dynamic_cast <calModel *> (model_);
+
+  if (!model)
+    return noAction;
+
+  if (instance_ -> interrupted ())
+    return stop;
+
+  // a solution below epsilon ends the search, except for a global
+  // optimum (-g), which stops only when the allowable gap is closed
+
+  double obj = model -> bestObj ();
+
+  if ((instance_ -> algType () != calInstance::GLOBAL) &&
+      (obj < 1e20) && (obj * obj <= instance_ -> eps ())) {
+
+#ifdef DEBUG
+    printf ("event handler: solution %g below epsilon, stopping\n", obj * obj);
+#endif
+
+    return stop;
+  }
+
+  if ((model -> deadline () < COIN_DBL_MAX) &&
+      (calWallTime () >= model -> deadline ()))
+    return stop;
+
+  return noAction;
+}
@@ -0,0 +1,46 @@
+/*
+ * optimal calibrated sampling -- event handler
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calEvent_hpp
+#define calEvent_hpp
+
+#include <CbcEventHandler.hpp>
+
+class calInstance;
+
+//
+// Stops the branch-and-bound as soon as the incumbent found by
+// calModel::checkSolution () has squared norm below epsilon, which
+// is all calModel::search () needs (see option -e), rather than when
+// the node or time limit is hit. Also stops it at the wall-clock
+// deadline of the calModel (Cbc's own limit is on CPU time), and if
+// the cancellation flag of the instance is set.
+//
+
+class calEventHandler: public CbcEventHandler {
+
+protected:
+
+  calInstance *instance_;
+
+public:
+
+  calEventHandler (calInstance *inst):
+    CbcEventHandler (),
+    instance_ (inst) {}
+
+  calEventHandler (const calEventHandler &rhs):
+    CbcEventHandler (rhs),
+    instance_ (rhs.instance_) {}
+
+  virtual CbcEventHandler *clone () const
+  {return new calEventHandler (*this);}
+
+  virtual CbcAction event (CbcEvent whichEvent);
+};
+
+#endif
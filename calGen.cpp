@@ -0,0 +1,75 @@
+/*
+ * optimal calibrated sampling -- generator of random instances
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "calSynth.hpp"
+#include "calClock.hpp"
+#include "cmdLine.hpp"
+
+//
+// calgen: writes an instance file (see "calibri -h") with a random
+// population from calSynth.hpp
+//
+
+int main (int argc, char *argv []) {
+
+  calSynthSpec spec;
+
+  bool needHelp = false;
+
+  tpar options [] = {{ 'N', (char *) "population",    1000, &spec.N,       ::TINT,    (char *) "population size"}
+		     ,{'n', (char *) "sample-size",    100, &spec.n,       ::TINT,    (char *) "sample size"}
+		     ,{'p', (char *) "calib",            4, &spec.p,       ::TINT,    (char *) "number of calibration vectors"}
+		     ,{'d', (char *) "density",          1, &spec.density, ::TDOUBLE, (char *) "probability that a calibration value is nonzero"}
+		     ,{'D', (char *) "distribution",     0, NULL,          ::TSTRING, (char *) "distribution of nonzero values: \"uniform\" (default), \"binary\", or \"lognormal\""}
+		     ,{'u', (char *) "duplicates",       0, &spec.dupRate, ::TDOUBLE, (char *) "probability that a unit duplicates a previous one"}
+		     ,{'s', (char *) "seed",             1, &spec.seed,    ::TINT,    (char *) "random seed (also written to the instance)"}
+		     ,{'h', (char *) "help",             0, &needHelp,     ::TTOGGLE, (char *) "print this help"}
+		     ,{0,   (char *) "",                 0, NULL,          ::TTOGGLE, (char *) ""} /* THIS ENTRY ALWAYS AT THE END */
+  };
+
+  set_default_args (options);
+
+  char *dist = NULL;
+
+  options [4].par = &dist; // after set_default_args, as it is NULL
+
+  char **filenames = readargs (argc, argv, options);
+
+  if (needHelp || !filenames) {
+    printf ("%s -- write a random instance for calibri\n\n", argv [0]);
+    print_help (argv [0], options);
+    return 0;
+  }
+
+  if (dist) {
+    if      (!strcmp (dist, "binary"))    spec.dist = SYNTH_BINARY;
+    else if (!strcmp (dist, "lognormal")) spec.dist = SYNTH_LOGNORMAL;
+    free (dist);
+  }
+
+  if ((spec.N < 2) || (spec.n < 1) || (spec.n >= spec.N) || (spec.p < 1)) {
+    printf ("Error: need N >= 2, 1 <= n < N, and p >= 1\n");
+    return -1;
+  }
+
+  double start = calWallTime ();
+
+  bool ok = calSynthWrite (*filenames, spec, NULL);
+
+  if (ok) printf ("Instance %s written: N=%d, n=%d, p=%d (%gs)\n", *filenames, spec.N, spec.n, spec.p, calWallTime () - start);
+  else    printf ("Error: cannot write %s\n", *filenames);
+
+  for (int i=0; filenames [i]; ++i)
+    free (filenames [i]);
+  free (filenames);
+
+  return ok ? 0 : -1;
+}
@@ -13,6 +13,7 @@
 #include "math.h"
 
 #include "calInstance.hpp"
+#include "calRandom.hpp"
 #include "CoinHelperFunctions.hpp"
 #include <CoinTime.hpp>
 
@@ -24,6 +25,7 @@
 #endif
 
 #define EPS_DEFAULT 1
+#define STALL_DEFAULT .05
 
 //#define DEBUG
 
@@ -67,6 +69,45 @@ int get_string (FILE *f, char *line) {
   return 0;
 }
 
+//
+// Default value of all options
+//
+
+void calInstance::setDefaults () {
+
+  eps_        = -1;
+  maxIt_      = -1;   // No limit, BB will terminate upon finding optimal 
+  maxBB_      = -1;   // solution in all iterations
+  maxTime_    = -1;   // 
+  maxTotTime_ = -1;   // max total time is also infinity
+  nRepl_      = 1;
+  randSeed_   = -1;
+  algType_    = CUBE;
+  earlyStop_  = -1;
+  nSolves_    = 100;
+  stallPVal_  = STALL_DEFAULT;
+  poolSize_   = 0;
+  dupPolicy_  = DUP_ALLOW;
+  outFile_    = NULL;
+  outFormat_  = ROW_BASED;
+  levBranch_  = false;
+  nSeedRuns_  = 0;
+  xNorm_      = NULL;
+  linkObj_    = false;
+  benders_    = false;
+  noPresolve_ = false;
+  lightCube_  = false;
+  targetOnly_ = false;
+  quiet_      = false;
+  iterProjP_  = 0;
+  profFile_   = NULL;
+  profile_    = NULL;
+  deadline_   = COIN_DBL_MAX;
+  cancel_     = NULL;
+
+  rng_ [0] = rng_ [1] = rng_ [2] = 0;
+}
+
 //
 // Constructor
 //
@@ -75,19 +116,9 @@ calInstance::calInstance (char *filename):
 
   name_       (filename),
   d_          (NULL),
-  id_         (NULL),
-  eps_        (-1),
-  maxIt_      (-1),   // No limit, BB will terminate upon finding optimal 
-  maxBB_      (-1),   // solution in all iterations
-  maxTime_    (-1),   // 
-  maxTotTime_ (-1),   // max total time is also infinity
-  nRepl_      (1),
-  randSeed_   (-1),
-  algType_    (CUBE),
-  earlyStop_  (-1),
-  nSolves_    (100),
-  outFile_    (NULL),
-  outFormat_  (ROW_BASED) {
+  id_         (NULL) {
+
+  setDefaults ();
 
 #ifndef _MSC_VER
   FILE *f = fopen (filename , "r");
@@ -167,7 +198,10 @@ calInstance::calInstance (char *filename):
     case 'o': outFile_ = (char *) malloc (1024 * sizeof (char));
       sscanf         (line + 1, "%s",  outFile_);     break;
     case 'O': sscanf (line + 1, "%s",  idname); 
-      if (!(strcmp (idname, "block"))) outFormat_ = REPL_BLOCKS; break;
+      if      (!(strcmp (idname, "block")))  outFormat_ = REPL_BLOCKS;
+      else if (!(strcmp (idname, "sparse"))) outFormat_ = SPARSE;
+      else if (!(strcmp (idname, "binary"))) outFormat_ = BINARY;
+      break;
 
     case 'a': 
 
@@ -280,6 +314,62 @@ calInstance::calInstance (char *filename):
   //print ();
 }
 
+//
+// Constructor from memory
+//
+
+calInstance::calInstance (int N, int n, int p, const double *x, const char * const *ids):
+
+  name_       ("(memory)"),
+  N_          (N),
+  n_          (n),
+  p_          (p),
+  d_          (new double [N]),
+  X_          (new CoinPackedVector * [1 + p]),
+  id_         (new char * [N]) {
+
+  setDefaults ();
+
+  CoinFillN (d_,  N_, -1.); // filled with "uninitialized" red flags
+  CoinFillN (id_, N_, (char *) NULL);
+
+  if (ids)
+    for (int i=0; i<N_; ++i)
+      if (ids [i]) {
+	id_ [i] = new char [1 + strlen (ids [i])];
+	strcpy (id_ [i], 1 + strlen (ids [i]), ids [i]);
+      }
+
+  int    *ind  = new int    [N_];
+  double *elem = new double [N_];
+
+  for (int j=0; j<p_; ++j) {
+
+    int nnz = 0;
+
+    for (int i=0; i<N_; ++i)
+      if (fabs (x [(size_t) i * p_ + j]) > 1e-6) {
+	ind  [nnz]   = i;
+	elem [nnz++] = x [(size_t) i * p_ + j];
+      }
+
+    X_ [j] = new CoinPackedVector (nnz, ind, elem);
+  }
+
+  for (int i=0; i<N_; ++i) {
+    ind  [i] = i;
+    elem [i] = (double) n_ / N_;
+  }
+
+  X_ [p_] = new CoinPackedVector (N_, ind, elem);
+
+  delete [] ind;
+  delete [] elem;
+
+  eps_      = EPS_DEFAULT;
+  randSeed_ = (int)(time (NULL));
+}
+
 //
 // destructor
 //
@@ -293,6 +383,129 @@ calInstance::~calInstance () {
 
   delete [] X_; 
   delete [] id_;
+  delete [] xNorm_;
+
+  if (profFile_)
+    free (profFile_);
+}
+
+//
+// Change the sample size. The cardinality vector X_ [p_] is n/N for
+// all units
+//
+
+void calInstance::setSampleSize (int n) {
+
+  n_ = n;
+
+  double *elem = X_ [p_] -> getElements ();
+
+  for (int i = X_ [p_] -> getNumElements (); i--;)
+    elem [i] = (double) n_ / N_;
+}
+
+//
+// Random numbers (see calRandom.hpp), on this instance's state, so
+// that instances solved at the same time do not share it
+//
+
+void calInstance::seedRandom ()
+{calSeedRandom (rng_, randSeed_);}
+
+double calInstance::random ()
+{return calRandom (rng_);}
+
+//
+// norm of the calibration values of each unit, i.e., of each column
+// of the p calibration rows
+//
+
+const double *calInstance::xNorm () {
+
+  if (xNorm_)
+    return xNorm_;
+
+  xNorm_ = new double [N_];
+
+  CoinZeroN (xNorm_, N_);
+
+  for (int j=0; j<p_; ++j) {
+
+    const double *elements = X_ [j] -> getElements    ();
+    const int    *indices  = X_ [j] -> getIndices     ();
+    int           numEl    = X_ [j] -> getNumElements ();
+
+    for (int k=0; k<numEl; ++k)
+      xNorm_ [indices [k]] += elements [k] * elements [k];
+  }
+
+  for (int i=0; i<N_; ++i)
+    xNorm_ [i] = sqrt (xNorm_ [i]);
+
+  return xNorm_;
+}
+
+//
+// Remove calibration vectors that are implied by the others or by
+// the model: empty ones, constant ones (implied by the cardinality
+// and sum-of-deltas rows, as sum_i c w_i = c N), and multiples of a
+// previous vector. Returns the number of vectors removed
+//
+
+int calInstance::removeRedundantX () {
+
+  int newP = 0;
+
+  for (int j=0; j<p_; ++j) {
+
+    const double *elements = X_ [j] -> getElements    ();
+    const int    *indices  = X_ [j] -> getIndices     ();
+    int           numEl    = X_ [j] -> getNumElements ();
+
+    bool redundant = true;
+
+    for (int k=0; k<numEl; ++k)
+      if (fabs (elements [k] - ((numEl == N_) ? elements [0] : 0.)) > X_TOL * (1. + fabs (elements [k]))) {
+	redundant = false;
+	break;
+      }
+
+    for (int h=0; (h<newP) && !redundant; ++h) {
+
+      if (X_ [h] -> getNumElements () != numEl)
+	continue;
+
+      const double *elH = X_ [h] -> getElements ();
+      const int    *inH = X_ [h] -> getIndices  ();
+
+      double ratio = elements [0] / elH [0];
+
+      redundant = true;
+
+      for (int k=0; k<numEl; ++k)
+	if ((indices [k] != inH [k]) ||
+	    (fabs (elements [k] - ratio * elH [k]) > X_TOL * (1. + fabs (elements [k])))) {
+	  redundant = false;
+	  break;
+	}
+    }
+
+    if (redundant) delete X_ [j];
+    else X_ [newP++] = X_ [j];
+  }
+
+  int nRemoved = p_ - newP;
+
+  X_ [newP] = X_ [p_]; // cardinality vector is always the last
+
+  p_ = newP;
+
+  if (nRemoved && xNorm_) {
+    delete [] xNorm_;
+    xNorm_ = NULL;
+  }
+
+  return nRemoved;
 }
 
 //
@@ -335,6 +548,19 @@ void calInstance::print () {
   if (maxTotTime_ >= 0)           printf ("Total time allotted: %g\n",       maxTotTime_);
   if (maxBB_      >= 0)           printf ("BB nodes limit: %d\n",            maxBB_);
   if (nSolves_    >= 0)           printf ("Solutions per replication: %d\n", nSolves_);
+  if (stallPVal_  != STALL_DEFAULT) printf ("Stall p-value: %g\n",          stallPVal_);
+  if (poolSize_   >  0)           printf ("Solution pool size: %d\n",        poolSize_);
+  if (dupPolicy_  != DUP_ALLOW)   printf ("Duplicate samples are %s\n",      (dupPolicy_ == DUP_REUSE) ? "reused" : "rejected");
+  if (levBranch_)                 printf ("Branching on calibration leverage\n");
+  if (nSeedRuns_  >  0)           printf ("Cube runs for pseudocosts: %d\n", nSeedRuns_);
+  if (linkObj_)                   printf ("Linking rows replaced by semicontinuous objects\n");
+  if (benders_)                   printf ("Benders decomposition\n");
+  if (noPresolve_)                printf ("No presolve\n");
+  if (lightCube_)                 printf ("Light Cube heuristic\n");
+  if (targetOnly_)                printf ("Only solutions below epsilon sought\n");
+  if (quiet_)                     printf ("Samples not printed\n");
+  if (iterProjP_  >  0)           printf ("Iterative projection from p = %d\n", iterProjP_);
+  if (profFile_)                  printf ("Profiling report: %s\n",         profFile_);
 
   printf                                 ("Random seed: %d\n",               randSeed_);
 }
@@ -21,6 +21,14 @@
 #define strcpy(a,b,c) strncpy(a,c,b)
 #endif
 
+namespace calibri {class Sampler;}
+
+class calProfile;
+struct tpar;
+
+#define EPS_W 1e-2 // minimum weight of a selected unit (delta_i >= -w0 + EPS_W)
+#define X_TOL 1e-9 // relative tolerance for comparing calibration values
+
 ///
 /// Instance class. Packs all info contained in input file, plus some
 /// flags specified at the command line.
@@ -29,11 +37,14 @@
 class calInstance {
 
   friend int main (int, char **); 
+  friend class calibri::Sampler;
+  friend calInstance *readInstance (char *, tpar *, int, char **);
 
 public:
 
   enum AlgType   {RANDOM, CUBE, GLOBAL};
-  enum OutFormat {ROW_BASED, REPL_BLOCKS};
+  enum OutFormat {ROW_BASED, REPL_BLOCKS, SPARSE, BINARY};
+  enum DupPolicy {DUP_ALLOW, DUP_REUSE, DUP_REJECT};
 
 protected:
 
@@ -54,12 +65,38 @@ protected:
   enum AlgType       algType_;    ///< algorithm type
   double             earlyStop_;  ///< stop Flight phase at this * (N-p-1) iterations. Default: 1
   int                nSolves_;    ///< solve this many problems before giving up
+  double             stallPVal_;  ///< stop a replication when the chance of improving is below this (0: never)
+  int                poolSize_;   ///< max # samples below eps kept for later replications (0: none)
+  enum DupPolicy     dupPolicy_;  ///< what to do with a sample already output by a replication
   char              *outFile_;    ///< filename for output
   enum OutFormat     outFormat_;  ///< output format
+  bool               levBranch_;  ///< branch on s variables ranked by calibration leverage
+  int                nSeedRuns_;  ///< # Cube runs to seed pseudocosts of s variables (0: none)
+  double            *xNorm_;      ///< norm of each unit's calibration values (computed on demand)
+  bool               linkObj_;    ///< linking rows replaced by semicontinuous branching objects
+  bool               benders_;    ///< Benders decomposition: master on s, weights as subproblem
+  bool               noPresolve_; ///< do not presolve instance and root MILP
+  bool               lightCube_;  ///< Cube heuristic without nested branch-and-bound
+  bool               targetOnly_; ///< any solution below eps will do: use sqrt(eps) as BB cutoff
+  bool               quiet_;      ///< do not print sample and weights of each replication
+  int                iterProjP_;  ///< project iteratively when p is at least this (0: never)
+  char              *profFile_;   ///< filename for the JSON report of the profiling counters (NULL: none)
+  calProfile        *profile_;    ///< profiling counters (NULL: not profiled); not owned
+
+  double             deadline_;   ///< calWallTime () at which to stop all replications (COIN_DBL_MAX: none)
+  const volatile bool *cancel_;   ///< if set (by another thread or a signal handler), stop asap; not owned
+  unsigned short     rng_ [3];    ///< state of the random number generator (as in erand48)
+
+  void setDefaults ();            ///< default value of all options
 
 public:
 
   calInstance (char *filename); ///< constructor from argument list
+
+  /// constructor from memory: x has N rows of p calibration values,
+  /// one per unit, and ids (optional) the N unit names
+  calInstance (int N, int n, int p, const double *x, const char * const *ids = NULL);
+
   ~calInstance ();              ///< destructor
 
   // get () methods
@@ -83,9 +120,46 @@ public:
   int    &randSeed       ()        {return randSeed_;}
   double  earlyStop      ()        {return earlyStop_;}
   int    &nSolves        ()        {return nSolves_;}
+  double  stallPValue    ()        {return stallPVal_;}
+  int     poolSize       ()        {return poolSize_;}
+
+  bool   &leverageBranch ()        {return levBranch_;}
+  int    &nSeedRuns      ()        {return nSeedRuns_;}
+  bool   &linkObjects    ()        {return linkObj_;}
+  bool   &benders        ()        {return benders_;}
+  bool   &noPresolve     ()        {return noPresolve_;}
+  bool   &lightCube      ()        {return lightCube_;}
+  bool   &targetOnly     ()        {return targetOnly_;}
+  bool   &quiet          ()        {return quiet_;}
+  int     iterProjection ()        {return iterProjP_;}
+  char  *&outFile        ()        {return outFile_;}
+  char  *&profileFile    ()        {return profFile_;}
+
+  calProfile *&profile   ()        {return profile_;}
+
+  double              &deadline   () {return deadline_;}
+  const volatile bool *&cancelFlag () {return cancel_;}
+
+  /// true if the cancellation flag is set
+  bool    interrupted    ()        {return cancel_ && *cancel_;}
+
+  /// uniform in [0,1), from this instance's own generator: the same
+  /// sequence as drand48 () after srand48 (randSeed ())
+  double  random         ();
+  void    seedRandom     ();
+
+  /// column of s_i in the MILP: 1+N+i, or 1+i in the Benders master
+  int     sCol           (int i)   {return (benders_ ? 1 : 1 + N_) + i;}
 
   enum AlgType   &algType   ()     {return algType_;}
   enum OutFormat &outFormat ()     {return outFormat_;}
+  enum DupPolicy &dupPolicy ()     {return dupPolicy_;}
+
+  const double *xNorm ();          ///< ||(x_i1 ... x_ip)||_2 for each unit i
+
+  int removeRedundantX ();         ///< remove empty, constant and duplicate calibration vectors
+
+  void setSampleSize (int n);      ///< change n (and the cardinality vector X_ [p_])
 
   void print ();
 };
@@ -0,0 +1,353 @@
+/*
+ * optimal calibrated sampling -- iterative projection for many
+ * calibration vectors
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <cmath>
+
+#include "CoinHelperFunctions.hpp"
+#include "CoinPackedVector.hpp"
+
+#include "calInstance.hpp"
+#include "calIterProj.hpp"
+#include "calRandom.hpp"
+#include "calSimd.hpp"
+
+#define ITER_PIVOT_TOL 1e-12 // Cholesky pivots below this times the largest: A not of full rank
+
+// hash of a unit's column in the sketch
+
+static unsigned int mix (unsigned int h) {
+
+  h ^= h >> 16; h *= 0x85ebca6bU;
+  h ^= h >> 13; h *= 0xc2b2ae35U;
+  h ^= h >> 16;
+
+  return h;
+}
+
+static double dot (const double *a, const double *b, int n) {
+
+  double s = 0.;
+
+  for (int i=0; i<n; ++i)
+    s += a [i] * b [i];
+
+  return s;
+}
+
+calIterProj::calIterProj (calInstance *instance):
+
+  instance_  (instance),
+  N_         (instance -> N ()),
+  pp_        (1 + instance -> p ()),
+  nSolves_   (0),
+  firstIter_ (0),
+  lastIter_  (0),
+  R_         (NULL),
+  frac_      (new char   [N_]),
+  t_         (new double [N_]),
+  y_         (new double [pp_]),
+  r_         (new double [pp_]),
+  z_         (new double [pp_]),
+  d_         (new double [pp_]),
+  q_         (new double [pp_]) {
+
+  calSeedRandom (rng_, instance -> randSeed ());
+}
+
+calIterProj::~calIterProj () {
+
+  delete [] R_;
+  delete [] frac_;
+  delete [] t_;
+  delete [] y_;
+  delete [] r_;
+  delete [] z_;
+  delete [] d_;
+  delete [] q_;
+}
+
+// t = A' y, on the fractional units only
+
+void calIterProj::multAt (const double *y, double *t) const {
+
+  CoinZeroN (t, N_);
+
+  for (int i=0; i<pp_; ++i) {
+
+    CoinPackedVector *x = instance_ -> X () [i];
+
+    const double *elements = x -> getElements    ();
+    const int    *indices  = x -> getIndices     ();
+    int           numEl    = x -> getNumElements ();
+
+    double yi = y [i];
+
+    for (int j=0; j<numEl; ++j)
+      if (frac_ [indices [j]])
+	t [indices [j]] += elements [j] * yi;
+  }
+}
+
+// q = A t, for t zero on the integer units of X (as are v and A' y)
+
+void calIterProj::multA (const double *t, double *q) const {
+
+  for (int i=0; i<pp_; ++i) {
+
+    CoinPackedVector *x = instance_ -> X () [i];
+
+    q [i] = calSimd () -> sparseDot (x -> getElements (), x -> getIndices (), x -> getNumElements (), t);
+  }
+}
+
+// R with R'R = (SA')' (SA'), where S has ITER_SKETCH_ROWS * pp rows
+// and ITER_SKETCH_NNZ entries +-1/sqrt (ITER_SKETCH_NNZ) per column,
+// in random rows
+
+void calIterProj::buildPreconditioner () {
+
+  int s = ITER_SKETCH_ROWS * pp_;
+
+  double
+    *SA    = new double [s * pp_],
+     scale = 1. / sqrt ((double) ITER_SKETCH_NNZ);
+
+  CoinZeroN (SA, s * pp_);
+
+  unsigned int seed = (unsigned int) (calRandom (rng_) * 4294967296.);
+
+  for (int i=0; i<pp_; ++i) {
+
+    CoinPackedVector *x = instance_ -> X () [i];
+
+    const double *elements = x -> getElements    ();
+    const int    *indices  = x -> getIndices     ();
+    int           numEl    = x -> getNumElements ();
+
+    for (int j=0; j<numEl; ++j) {
+
+      int c = indices [j];
+
+      if (!frac_ [c])
+	continue;
+
+      for (int k=0; k<ITER_SKETCH_NNZ; ++k) {
+
+	unsigned int h = mix (seed ^ mix ((unsigned int) c * ITER_SKETCH_NNZ + k));
+
+	SA [(h % s) * pp_ + i] += ((h & 0x80000000U) ? -scale : scale) * elements [j];
+      }
+    }
+  }
+
+  // M = (SA')' (SA'), upper triangle
+
+  double *M = new double [pp_ * pp_];
+
+  CoinZeroN (M, pp_ * pp_);
+
+  for (int r=0; r<s; ++r) {
+
+    const double *a = SA + r * pp_;
+
+    for (int i=0; i<pp_; ++i)
+      if (a [i] != 0.)
+	for (int j=i; j<pp_; ++j)
+	  M [i*pp_ + j] += a [i] * a [j];
+  }
+
+  delete [] SA;
+
+  // Cholesky factor. A pivot near zero means a row of A that depends
+  // on the previous ones (or is zero): leave it out of the
+  // preconditioner
+
+  double maxDiag = 0.;
+
+  for (int i=0; i<pp_; ++i)
+    if (M [i*pp_ + i] > maxDiag)
+      maxDiag = M [i*pp_ + i];
+
+  if (maxDiag <= 0.)
+    maxDiag = 1.;
+
+  if (!R_)
+    R_ = new double [pp_ * pp_];
+
+  CoinZeroN (R_, pp_ * pp_);
+
+  for (int i=0; i<pp_; ++i) {
+
+    double d = M [i*pp_ + i];
+
+    for (int k=0; k<i; ++k)
+      d -= R_ [k*pp_ + i] * R_ [k*pp_ + i];
+
+    if (d <= ITER_PIVOT_TOL * maxDiag) {
+      R_ [i*pp_ + i] = sqrt (maxDiag);
+      continue;
+    }
+
+    double rii = R_ [i*pp_ + i] = sqrt (d);
+
+    for (int j=i+1; j<pp_; ++j) {
+
+      double m = M [i*pp_ + j];
+
+      for (int k=0; k<i; ++k)
+	m -= R_ [k*pp_ + i] * R_ [k*pp_ + j];
+
+      R_ [i*pp_ + j] = m / rii;
+    }
+  }
+
+  delete [] M;
+}
+
+// z = inv (R'R) r: solve R' w = r, then R z = w
+
+void calIterProj::precondition (const double *r, double *z) const {
+
+  for (int i=0; i<pp_; ++i) {
+
+    double w = r [i];
+
+    for (int k=0; k<i; ++k)
+      w -= R_ [k*pp_ + i] * z [k];
+
+    z [i] = w / R_ [i*pp_ + i];
+  }
+
+  for (int i=pp_; i--;) {
+
+    double w = z [i];
+
+    for (int j=i+1; j<pp_; ++j)
+      w -= R_ [i*pp_ + j] * z [j];
+
+    z [i] = w / R_ [i*pp_ + i];
+  }
+}
+
+// preconditioned conjugate gradient on A A' y = A v, from y = 0. The
+// residual A v - A A' y is A u
+
+int calIterProj::solve (const double *v, bool &converged) {
+
+  CoinZeroN (y_, pp_);
+
+  multA (v, r_);
+
+  double
+    bNorm = sqrt (dot (r_, r_, pp_)),
+    rz    = 0.;
+
+  int nIter = 0;
+
+  converged = (bNorm == 0.);
+
+  if (converged)
+    return 0;
+
+  precondition (r_, z_);
+  CoinCopyN (z_, pp_, d_);
+
+  rz = dot (r_, z_, pp_);
+
+  while (nIter < 2 * pp_) {
+
+    multAt (d_, t_);
+    multA  (t_, q_);
+
+    double dq = dot (d_, q_, pp_);
+
+    if (dq <= 0.) // d in the null space of A': breakdown
+      break;
+
+    double alpha = rz / dq;
+
+    for (int i=0; i<pp_; ++i) {
+      y_ [i] += alpha * d_ [i];
+      r_ [i] -= alpha * q_ [i];
+    }
+
+    ++nIter;
+
+    if (sqrt (dot (r_, r_, pp_)) <= ITER_PROJ_TOL * bNorm) {
+      converged = true;
+      break;
+    }
+
+    precondition (r_, z_);
+
+    double rzNew = dot (r_, z_, pp_);
+
+    for (int i=0; i<pp_; ++i)
+      d_ [i] = z_ [i] + (rzNew / rz) * d_ [i];
+
+    rz = rzNew;
+  }
+
+  return nIter;
+}
+
+int calIterProj::project (double *v, double *u, const double *pi) {
+
+  // fractional units; v is zeroed at the others, as in project ()
+
+  for (int c=0; c<N_; ++c)
+    frac_ [c] = (fabs (pi [c] - .5) < (.5 - 1e-5)) ? 1 : 0;
+
+  for (int i=0; i<pp_; ++i) {
+
+    CoinPackedVector *x = instance_ -> X () [i];
+
+    const int *indices = x -> getIndices     ();
+    int        numEl   = x -> getNumElements ();
+
+    for (int j=0; j<numEl; ++j)
+      if (!frac_ [indices [j]])
+	v [indices [j]] = 0.;
+  }
+
+  if (!R_ || (lastIter_ > ITER_PROJ_SLOW * firstIter_) || (nSolves_ >= ITER_PROJ_REFRESH)) {
+    buildPreconditioner ();
+    nSolves_ = 0;
+  }
+
+  bool converged;
+
+  int
+    nIter  = solve (v, converged),
+    nTotal = nIter;
+
+  if (!converged) { // stale or unlucky sketch: a new one, and retry once
+    buildPreconditioner ();
+    nSolves_ = 0;
+    nTotal += (nIter = solve (v, converged));
+  }
+
+  ++nSolves_;
+
+  lastIter_ = nIter;
+
+  if (1 == nSolves_)
+    firstIter_ = nIter;
+
+  if (!converged)
+    return -1;
+
+  // u = v - A' y
+
+  multAt (y_, t_);
+
+  for (int c=0; c<N_; ++c)
+    u [c] = v [c] - t_ [c];
+
+  return nTotal;
+}
@@ -0,0 +1,87 @@
+/*
+ * optimal calibrated sampling -- iterative projection for many
+ * calibration vectors
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calIterProj_hpp
+#define calIterProj_hpp
+
+class calInstance;
+
+#define ITER_PROJ_TOL      1e-10 // stop when |A u| <= this * |A v|
+#define ITER_PROJ_SLOW     2     // rebuild the preconditioner when a solve takes this times the first with it...
+#define ITER_PROJ_REFRESH  50    // ... or after this many solves
+#define ITER_SKETCH_ROWS   4     // rows of the sketch per row of A
+#define ITER_SKETCH_NNZ    4     // nonzeros per column of the sketch
+
+//
+// Projection of v on the null space of A (the calibration vectors
+// restricted to the fractional units) as in CalCubeHeur::project (),
+// for large p (option -I): u = v - A' y, with y a solution of
+//
+//   A A' y = A v
+//
+// found by conjugate gradient, where A and A' are only applied through
+// the sparse calibration vectors: no dense (p+1) x N matrix, each
+// iteration costs O(nonzeros), and memory is O(N + p^2) beyond the
+// calibration vectors.
+//
+// The preconditioner is R' R, where R is the Cholesky factor of
+// (S A')' (S A') and S is a random sparse sign matrix with few rows
+// (a sketch): then R' R is close to A A', and few iterations are
+// needed. Building R costs O(p^3), so it is kept for the next flight
+// phase steps, as A changes little from one to the next, and rebuilt
+// only when a solve becomes slow or every ITER_PROJ_REFRESH solves.
+//
+// If a solve misses the tolerance (iteration limit, or breakdown), the
+// preconditioner is rebuilt from a new sketch and the solve retried
+// once; if that fails too, project () says so and the caller uses the
+// dense projection.
+//
+// One per CalCubeHeur, as it keeps the preconditioner and workspace.
+//
+
+class calIterProj {
+
+protected:
+
+  calInstance *instance_;
+
+  int     N_;
+  int     pp_;        ///< rows of A: p+1
+  int     nSolves_;   ///< since the preconditioner was built
+  int     firstIter_; ///< iterations of the first solve with it
+  int     lastIter_;  ///< iterations of the last solve
+
+  double *R_;         ///< upper triangular, by rows (NULL: to build)
+  char   *frac_;      ///< 1 if the unit is fractional
+  double *t_;         ///< N-vector
+  double *y_, *r_, *z_, *d_, *q_; ///< pp-vectors of the conjugate gradient
+
+  unsigned short rng_ [3]; ///< sketches only: the instance's sequence is not touched
+
+  void buildPreconditioner ();
+  void precondition (const double *r, double *z) const; ///< z = inv (R' R) * r
+
+  void multAt (const double *y, double *t) const; ///< t = A' y
+  void multA  (const double *t, double *q) const; ///< q = A t
+
+  /// preconditioned CG on A A' y = A v, from y = 0. Returns the number
+  /// of iterations; converged is false if the tolerance was missed
+  int  solve (const double *v, bool &converged);
+
+public:
+
+  calIterProj  (calInstance *instance);
+  ~calIterProj ();
+
+  /// same as CalCubeHeur::project (). Returns the number of
+  /// iterations, or -1 if it did not converge: then u is not set, while
+  /// v is zeroed on the integer units as in CalCubeHeur::project ()
+  int project (double *v, double *u, const double *pi);
+};
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * optimal calibrated sampling -- large neighbourhood search
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <OsiSolverInterface.hpp>
+#include <CoinHelperFunctions.hpp>
+#include <CoinSort.hpp>
+
+#include "calLNS.hpp"
+#include "calInstance.hpp"
+#include "calClock.hpp"
+
+//#define DEBUG
+
+static const char *opName [] = {"residual", "uniform"};
+
+calLNS::calLNS (calInstance *inst):
+
+  instance_ (inst),
+  frac_     (LNS_INIT_FRAC),
+  lastOp_   (-1),
+  lastStart_ (0.) {
+
+  for (int k=0; k<N_OPERATORS; ++k) {
+    score_     [k] = 1.;
+    nUsed_     [k] = 0;
+    nImproved_ [k] = 0;
+    gain_      [k] = 0.;
+    time_      [k] = 0.;
+  }
+
+  key_   = new double [inst -> N ()];
+  order_ = new int    [inst -> N ()];
+}
+
+calLNS::~calLNS () {
+
+  delete [] key_;
+  delete [] order_;
+}
+
+// Fix all units of a group (s_i = value) but k of them. Sampling
+// without replacement with probability proportional to weight: the k
+// smallest keys -log(u)/weight_i (Efraimidis and Spirakis)
+
+void calLNS::freeGroup (OsiSolverInterface &si, const double *s, double value,
+			const double *weight, int k) {
+
+  int
+    N      = instance_ -> N (),
+    nGroup = 0;
+
+  for (int i=0; i<N; ++i)
+    if (fabs (s [i] - value) < .5) {
+      order_ [nGroup]   = i;
+      key_   [nGroup++] = -log (1. - instance_ -> random ()) / (weight ? CoinMax (weight [i], 1e-12) : 1.);
+    }
+
+  CoinSort_2 (key_, key_ + nGroup, order_);
+
+  for (int h = k; h < nGroup; ++h)
+    if (value > .5) si.setColLower (instance_ -> sCol (order_ [h]), 1.);
+    else            si.setColUpper (instance_ -> sCol (order_ [h]), 0.);
+}
+
+// Fix the s variables in si around sol except for a neighbourhood
+
+int calLNS::freeUnits (OsiSolverInterface &si, const double *sol) {
+
+  int
+    N = instance_ -> N (),
+    n = instance_ -> n (),
+    p = instance_ -> p ();
+
+  const double
+    *delta = sol + 1,
+    *s     = sol + 1 + N;
+
+  // pick operator
+
+  double sumScore = 0.;
+
+  for (int k=0; k<N_OPERATORS; ++k)
+    sumScore += score_ [k];
+
+  double pick = instance_ -> random () * sumScore;
+
+  for (lastOp_ = 0; lastOp_ < N_OPERATORS - 1; ++lastOp_)
+    if ((pick -= score_ [lastOp_]) < 0.)
+      break;
+
+  int
+    k1 = CoinMax (1, CoinMin (n,     (int) floor (frac_ * n       + .5))),
+    k0 = CoinMax (1, CoinMin (N - n, (int) floor (frac_ * (N - n) + .5)));
+
+  if (RESIDUAL == lastOp_) {
+
+    // r = sum_i delta_i x_i, then weight_i from x_i'r
+
+    CoinPackedVector **X = instance_ -> X ();
+
+    const double *xNorm = instance_ -> xNorm ();
+
+    double
+      *r      = new double [p],
+      *dot    = new double [N],
+      *weight = new double [N],
+      rNorm   = 0.,
+      w0      = (double) N / n;
+
+    CoinZeroN (r,   p);
+    CoinZeroN (dot, N);
+
+    for (int j=0; j<p; ++j) {
+
+      const int    *ind = X [j] -> getIndices     ();
+      const double *val = X [j] -> getElements    ();
+      int           num = X [j] -> getNumElements ();
+
+      for (int h=0; h<num; ++h)
+	r [j] += delta [ind [h]] * val [h];
+
+      rNorm += r [j] * r [j];
+    }
+
+    rNorm = sqrt (rNorm);
+
+    for (int j=0; j<p; ++j) {
+
+      const int    *ind = X [j] -> getIndices     ();
+      const double *val = X [j] -> getElements    ();
+      int           num = X [j] -> getNumElements ();
+
+      for (int h=0; h<num; ++h)
+	dot [ind [h]] += val [h] * r [j];
+    }
+
+    // cosine of x_i and r (sign flipped for selected units), plus the
+    // relative change of the weight of selected units
+
+    for (int i=0; i<N; ++i) {
+
+      double cosine = ((xNorm [i] > 0.) && (rNorm > 0.)) ? dot [i] / (xNorm [i] * rNorm) : 0.;
+
+      weight [i] = LNS_SCORE_MIN + ((s [i] > .5) ?
+				    CoinMax (0., -cosine) + fabs (delta [i]) / w0 :
+				    CoinMax (0.,  cosine));
+    }
+
+    freeGroup (si, s, 1., weight, k1);
+    freeGroup (si, s, 0., weight, k0);
+
+    delete [] r;
+    delete [] dot;
+    delete [] weight;
+
+  } else {
+
+    freeGroup (si, s, 1., NULL, k1);
+    freeGroup (si, s, 0., NULL, k0);
+  }
+
+#ifdef DEBUG
+  printf ("LNS: %s, freeing %d ones and %d zeros (fraction %g)\n", opName [lastOp_], k1, k0, frac_);
+#endif
+
+  lastStart_ = calWallTime ();
+
+  return k0 + k1;
+}
+
+// Record the outcome of the BB run started after freeUnits ()
+
+void calLNS::update (double oldObj, double newObj, bool exhausted) {
+
+  if (lastOp_ < 0)
+    return;
+
+  bool improved = (newObj < oldObj - 1e-9 * (1. + fabs (oldObj)));
+
+  double reward = improved ?
+    ((oldObj < 1e20) ? (oldObj - newObj) / (1e-9 + oldObj) : 1.) : 0.;
+
+  ++nUsed_ [lastOp_];
+  time_    [lastOp_] += calWallTime () - lastStart_;
+
+  if (improved) {
+    ++nImproved_ [lastOp_];
+    if (oldObj < 1e20)
+      gain_ [lastOp_] += oldObj - newObj;
+  }
+
+  score_ [lastOp_] = CoinMax (LNS_SCORE_MIN, (1. - LNS_DECAY) * score_ [lastOp_] + LNS_DECAY * reward);
+
+  // neighbourhood size: grow if the BB proved there is nothing better
+  // in it, shrink if it could not finish without improving
+
+  if      (exhausted && !improved) frac_ = CoinMin (LNS_MAX_FRAC, frac_ * LNS_GROW);
+  else if (!exhausted && !improved) frac_ = CoinMax (LNS_MIN_FRAC, frac_ * LNS_SHRINK);
+
+  lastOp_ = -1;
+}
+
+void calLNS::print () {
+
+  printf ("LNS operators (fraction freed now %g):\n", frac_);
+
+  for (int k=0; k<N_OPERATORS; ++k)
+    if (nUsed_ [k])
+      printf ("  %-10s used %4d, improved %4d, gain %10.4g, time %8.2fs, score %g\n",
+	      opName [k], nUsed_ [k], nImproved_ [k], gain_ [k], time_ [k], score_ [k]);
+}
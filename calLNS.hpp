@@ -0,0 +1,85 @@
+/*
+ * optimal calibrated sampling -- large neighbourhood search
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calLNS_hpp
+#define calLNS_hpp
+
+class calInstance;
+class OsiSolverInterface;
+
+#define LNS_INIT_FRAC 0.1  // initial fraction of ones (and of zeros) freed
+#define LNS_MIN_FRAC  1e-3 // bounds on the fraction (at least one unit is freed anyway)
+#define LNS_MAX_FRAC  0.5
+#define LNS_GROW      1.5  // fraction multiplied by this if the BB exhausted the neighbourhood
+#define LNS_SHRINK    0.7  // ... and by this if it hit its limits without improving
+#define LNS_DECAY     0.2  // weight of the last outcome in an operator's score
+#define LNS_SCORE_MIN 0.05 // minimum score (keeps all operators alive)
+
+//
+// Adaptive controller for the neighbourhoods explored by
+// calModel::search. At each retry, all s variables are fixed at the
+// current best sample except for a fraction of the ones and of the
+// zeros, chosen by one of two operators:
+//
+// RESIDUAL: if r = sum_i delta_i x_i is the calibration correction
+//   made by the weights, a selected unit i is freed with probability
+//   increasing in |delta_i| and in -x_i'r, and an unselected unit in
+//   x_i'r, i.e., in how much removing/adding it would reduce the
+//   correction;
+//
+// UNIFORM: units are freed uniformly at random.
+//
+// Operators are picked at random with probability proportional to
+// their (exponentially smoothed) success. The fraction grows when the
+// BB run proves its neighbourhood has nothing better, and shrinks when
+// it runs out of time or nodes without improving.
+//
+
+class calLNS {
+
+public:
+
+  enum Operator {RESIDUAL, UNIFORM, N_OPERATORS};
+
+protected:
+
+  calInstance *instance_;
+
+  double  frac_;                   ///< current fraction of freed units
+  int     lastOp_;                 ///< operator used at last call to freeUnits ()
+  double  lastStart_;              ///< time of last call to freeUnits ()
+
+  double  score_    [N_OPERATORS]; ///< smoothed success of each operator
+  int     nUsed_    [N_OPERATORS]; ///< statistics
+  int     nImproved_[N_OPERATORS];
+  double  gain_     [N_OPERATORS];
+  double  time_     [N_OPERATORS];
+
+  double *key_;                    ///< workspace, N
+  int    *order_;                  ///< workspace, N
+
+  /// fix all units of a group (s_i = value) but k of them, chosen
+  /// with probability proportional to weight
+  void freeGroup (OsiSolverInterface &si, const double *s, double value,
+		  const double *weight, int k);
+
+public:
+
+  calLNS  (calInstance *inst);
+  ~calLNS ();
+
+  /// Fix the s variables in si around sol (in z, delta, s layout)
+  /// except for a neighbourhood. Returns the number of freed units
+  int freeUnits (OsiSolverInterface &si, const double *sol);
+
+  /// Record the outcome of the BB run started after freeUnits ()
+  void update (double oldObj, double newObj, bool exhausted);
+
+  void print ();
+};
+
+#endif
@@ -29,6 +29,15 @@
 #include "calCut.hpp"
 #include "calBT.hpp"
 #include "calCube.hpp"
+#include "calBranch.hpp"
+#include "calBenders.hpp"
+#include "calWeights.hpp"
+#include "calEvent.hpp"
+#include "calClock.hpp"
+#include "calPool.hpp"
+#include "calOutput.hpp"
+#include "calTrace.hpp"
+#include "calPerf.hpp"
 #include "cmdLine.hpp"
 
 //#define DEBUG
@@ -36,21 +45,28 @@
 //#define MAX_GAP 1e-1 // value at which to stop branch-and-bound
 
 //
-// Fill in LP's coefficient
+// Build the model and run all replications (calSolve.cpp)
 //
 
-int populate (calInstance *instance, OsiSolverInterface *problem);
+class OsiClpSolverInterface;
+
+int calSolve (calInstance *instance, calOutput *out, const OsiClpSolverInterface *root = NULL);
 
 //
-// Add cutting planes, heuristics, etc.
+// Serve requests on a Unix socket (calDaemon.cpp)
 //
 
-void addCbcExtras (calModel &calbb, int &cutGenCount);
+int calDaemon (const char *path, calInstance **instances, int nInstances, const volatile bool *stop);
 
+//
+// Run all instances listed in a manifest (calBatch.cpp)
+//
 
-/// global variable
-bool      GLOBAL_interrupt = false;
-CbcModel *GLOBAL_curBB     = NULL;
+int calBatchRun (const char *manifest, tpar *options, int argc, char **argv, const volatile bool *stop);
+
+/// global variable, only used here: the solver sees it as the
+/// cancellation flag of the instance, and stops at the next BB node
+volatile bool GLOBAL_interrupt = false;
 
 #define INTERRUPT_HANDLER
 
@@ -67,14 +83,8 @@ extern "C" {
       std::cerr << "[BREAK]" << std::endl;
       exit (-1);
 
-    } else {
-
+    } else
       GLOBAL_interrupt = true;
-      if (GLOBAL_curBB) {
-	GLOBAL_curBB -> setMaximumNodes   (0); // stop at next node
-	GLOBAL_curBB -> setMaximumSeconds (0);
-      }
-    }
 
     return;
   }
@@ -83,113 +93,22 @@ extern "C" {
 #endif
 
 
-//                     oo          
-//                                
-// 88d8b.d8b. .d8888b. dP 88d888b. 
-// 88'`88'`88 88'  `88 88 88'  `88 
-// 88  88  88 88.  .88 88 88    88 
-// dP  dP  dP `88888P8 dP dP    dP 
-
-int main (int argc, char *argv[]) {
-
-  if (argc <= 1) {
-    printf ("Usage: %s [options] <instance.txt>\nRun \"%s -h\" for help\n", argv [0], argv [0]);
-    exit (0);
-  }
-
-#ifdef INTERRUPT_HANDLER
-  signal (SIGINT, signal_handler);
-#endif
-
-  /*
-   * Specify program command line options
-   */
-
-  char **filenames;
-
-  bool needHelp = false;
-
-  tpar options [] = {{ 'n', (char *) "sample-size",     1, NULL,    ::TINT,    (char *) "sample size (n)"}
-		     ,{'e', (char *) "epsilon",        -1, NULL,    ::TDOUBLE, (char *) "stop BB optimization when objective below number"}
-
-		     ,{'i', (char *) "lp-iter",        -1, NULL,    ::TINT,    (char *) "LP iterations in each BB run"}
-		     ,{'k', (char *) "iterations",    100, NULL,    ::TINT,    (char *) "number of BB runs in each replication"}
-		     ,{'b', (char *) "bb-nodes",       -1, NULL,    ::TINT,    (char *) "number of subproblems in each BB run"}
-		     ,{'t', (char *) "time",           -1, NULL,    ::TDOUBLE, (char *) "CPU time allotted to each BB run"}
-		     ,{'T', (char *) "tot-time",       -1, NULL,    ::TDOUBLE, (char *) "maximum total CPU time"}
-
-		     ,{'R', (char *) "replications",    1, NULL,    ::TINT,    (char *) "number of replications (if \"-g\" chosen, it is ignored)"}
-		     ,{'s', (char *) "seed",           -1, NULL,    ::TINT,    (char *) "random seed (if not specified here or in input file, it is generated using time)"}
-		     ,{'f', (char *) "int-fixed",       1, NULL,    ::TDOUBLE, (char *) "portion of fixed variables before stopping flight phase of Cube"}
-		     ,{'o', (char *) "output",          0, NULL,    ::TSTRING, (char *) "output file"}
-		     ,{'O', (char *) "out-format",      0, NULL,    ::TSTRING, (char *) "output format: \"block\" for one unit per row, \"row\" (default) otherwise"}
-
-		     ,{'r', (char *) "random",          0, NULL,    ::TTOGGLE, (char *) "generate random initial point (overrides \"-g\" and \"-c\")"}
-		     ,{'c', (char *) "cube",            0, NULL,    ::TTOGGLE, (char *) "generate initial point through Cube"}
-		     ,{'g', (char *) "global",          0, NULL,    ::TTOGGLE, (char *) "find global optimum (overrides \"-c\")"}
-
-		     ,{'h', (char *) "help",            0, &needHelp, ::TTOGGLE, (char *) "print this help"}
-
-		     ,{0,   (char *) "",                0, NULL,    ::TTOGGLE,       (char *) ""} /* THIS ENTRY ALWAYS AT THE END */
-  };
-
-  // default parameter values
-
-  set_default_args (options);
-
-  // parse command line
-
-  filenames = readargs (argc, argv, options);
-
-  if (needHelp) {
-
-    printf ("\
-%s -- extract a calibrated sample\n\
-Synopsis: %s returns a set of samples of size n of a population U of size N.\n\
-The samples are calibrated w.r.t. a set of p auxiliary variable vectors.\n\
-Author: Pietro Belotti\n\
-Version: 0.1\n\
-License: Eclipse Public License\n\n", argv [0], argv [0]);
-
-    print_help (argv [0], options);
+//
+// Read an instance and set its options from the command line, which
+// override those in the file
+//
 
-    printf ("\n\
-Input file format as below:\n\
-\n\
-N 10 # cardinality of population U\n\
-n 3  # cardinality of sample S\n\
-p 4  # number of auxiliary variables\n\
-y 0 1 0 0 0 1 0 1 0 0 # initial solution (optional)\n\
-x 1 1 0 0 # auxiliary variables: N rows of p columns each\n\
-  0 0 1 0\n\
-  0 1 0 0\n\
-  0 0 0 1\n\
-  1 0 0 0\n\
-  0 1 0 0\n\
-  0 0 0 0\n\
-  0 0 1 1\n\
-  1 0 1 0\n\
-  0 1 0 0\n\
-I Pisa Parma Torino Roma Venezia Napoli Bari Palermo Bologna Milano\n\
-s 734642 # random seed (if -1 then generated using time)\n\
-\n\
-Output file format\nWithout option \"--out-format block\": for each replication, one line\n\
-containing the squared norm of (w-d), 0-1 vector with sample, and vector of weights.\n\
-\nWithout option \"--out-format block\": for each replication, one block of N lines.\n\
-Each line contains replication, function value, id, 0/1, and weight of each unit.\n\
-See user manual for mode details on input and output file formats.\n");
+calInstance *readInstance (char *filename, tpar *options, int argc, char **argv) {
 
-    exit (0);
-  }
+  calTraceSpan span ("read instance");
 
-  double nowTime = CoinCpuTime ();
-  calInstance *instance = NULL;
+  double nowTime = calWallTime ();
+  calPerfMark perf;
 
-  printf ("Calibri -- a solver for the optimal calibrated sampling problem\n");
-  printf ("Reading instance %s: ", filenames ? *filenames : "from std input"); fflush (stdout);
+  printf ("Reading instance %s: ", filename); fflush (stdout);
 
-  instance = new calInstance (*filenames);
-  printf ("done (%.3gs)\n", CoinCpuTime () - nowTime); fflush (stdout);
+  calInstance *instance = new calInstance (filename);
+  printf ("done (%.3gs)", calWallTime () - nowTime); perf. print (); printf ("\n"); fflush (stdout);
 
   options  [0].par =  &(instance -> n_);
   options  [1].par =  &(instance -> eps_);
@@ -218,20 +137,30 @@ See user manual for mode details on input and output file formats.\n");
   options [13].par =  &isCube;
   options [14].par =  &isGlobal;
 
-  options [15].par =  &needHelp;
+  options [15].par =  &(instance -> levBranch_);
+  options [16].par =  &(instance -> nSeedRuns_);
 
-  options [16].par = NULL; // redundant -- to end it
+  options [17].par =  &(instance -> linkObj_);
+  options [18].par =  &(instance -> benders_);
+  options [19].par =  &(instance -> lightCube_);
+  options [20].par =  &(instance -> targetOnly_);
+  options [21].par =  &(instance -> noPresolve_);
+  options [22].par =  &(instance -> stallPVal_);
+  options [23].par =  &(instance -> poolSize_);
 
-  // delete filenames
+  char *dupPol = NULL;
 
-  if (filenames) {
-    for (int i=0; filenames [i]; ++i)
-      free (filenames [i]);
-    free (filenames);
-  }
+  options [24].par =  &dupPol;
+
+  options [25].par =  &(instance -> quiet_);
+
+  // 26, 27, 29 and 30 (-U, -B, -Z, -H) are set in main ()
+
+  options [28].par =  &(instance -> profFile_);
+  options [31].par =  &(instance -> iterProjP_);
 
   // RE-READ options in order to override file-based options
-  filenames = readargs (argc, argv, options);
+  char **filenames = readargs (argc, argv, options);
 
   if (filenames) {
     for (int i=0; filenames [i]; ++i)
@@ -239,14 +168,47 @@ See user manual for mode details on input and output file formats.\n");
     free (filenames);
   }
 
-  if (outFor && (!(strcmp (outFor, "block"))))
-    instance -> outFormat_ = calInstance::REPL_BLOCKS;
+  // the clock started with the program, so the total time also
+  // accounts for reading the instance
+
+  if (instance -> maxTotalTime () >= 0.)
+    instance -> deadline () = instance -> maxTotalTime ();
+
+  instance -> cancelFlag () = &GLOBAL_interrupt;
+
+  if (outFor) {
+    if      (!(strcmp (outFor, "block")))  instance -> outFormat_ = calInstance::REPL_BLOCKS;
+    else if (!(strcmp (outFor, "sparse"))) instance -> outFormat_ = calInstance::SPARSE;
+    else if (!(strcmp (outFor, "binary"))) instance -> outFormat_ = calInstance::BINARY;
+  }
+
+  if (dupPol) {
+    if      (!(strcmp (dupPol, "reuse")))  instance -> dupPolicy () = calInstance::DUP_REUSE;
+    else if (!(strcmp (dupPol, "reject"))) instance -> dupPolicy () = calInstance::DUP_REJECT;
+  }
+
+  free (outFor); // read once per instance (in batch mode, per manifest line)
+  free (dupPol);
 
   instance -> algType_ = 
     isRandom ? calInstance::RANDOM :
     isGlobal ? calInstance::GLOBAL : 
                calInstance::CUBE;
 
+  if (instance -> nSeedRuns () > 0)
+    instance -> leverageBranch () = true;
+
+  if (instance -> benders () &&
+      (instance -> leverageBranch () ||
+       instance -> linkObjects    ())) {
+
+    printf ("Warning: Benders decomposition has no delta variables, options \"-L\", \"-P\", and \"-S\" ignored\n");
+
+    instance -> leverageBranch () = false;
+    instance -> nSeedRuns      () = 0;
+    instance -> linkObjects    () = false;
+  }
+
   if ((instance -> d ()) && 
       ((instance -> algType () != calInstance::RANDOM) ||
        (instance -> nReplications () > 1))) {
@@ -270,8 +232,8 @@ Specify \"a rand\" in the input file or option \"-r\" at the command line and se
 
   if (instance -> nReplications () < 1) {
     printf ("No replications requested.\nExiting.\n");
-    if (instance) delete instance;
-    exit (0);
+    delete instance;
+    return NULL;
   }
 
   // if ((instance -> nReplications () > 1) && (instance -> d () [0] >= 0.)) {
@@ -297,131 +259,245 @@ Specify \"a rand\" in the input file or option \"-r\" at the command line and se
 
   // Sanity check done ---------------------------------------------------
 
-  instance -> print ();
+  return instance;
+}
 
-  OsiClpSolverInterface model;
 
-  printf ("Creating MILP: ");
-  nowTime = CoinCpuTime ();
-  populate (instance, &model);
-  printf ("done (%gs)\n", CoinCpuTime () - nowTime);
+//                     oo          
+//                                
+// 88d8b.d8b. .d8888b. dP 88d888b. 
+// 88'`88'`88 88'  `88 88 88'  `88 
+// 88  88  88 88.  .88 88 88    88 
+// dP  dP  dP `88888P8 dP dP    dP 
 
-  model. messageHandler () -> setLogLevel (0);
+int main (int argc, char *argv[]) {
 
-  calModel calbb (model, instance);
+  if (argc <= 1) {
+    printf ("Usage: %s [options] <instance.txt>\nRun \"%s -h\" for help\n", argv [0], argv [0]);
+    exit (0);
+  }
 
-  calbb. messageHandler () -> setLogLevel ((calInstance::GLOBAL == instance -> algType ()) ? 1 : 0);
+#ifdef INTERRUPT_HANDLER
+  signal (SIGINT, signal_handler);
+#endif
 
-  calbb. setAllowableGap (instance -> eps ());
+  /*
+   * Specify program command line options
+   */
 
-  int cgCnt = 0;
+  char **filenames;
 
-  addCbcExtras (calbb, cgCnt);
+  bool needHelp = false;
 
-  calCut cutgen (instance);
-  calbb. addCutGenerator (&cutgen, 1, "Conic cuts", true, false, false, 1);
-  calbb. cutGenerator (cgCnt++) -> setGlobalCuts (true);
+  tpar options [] = {{ 'n', (char *) "sample-size",     1, NULL,    ::TINT,    (char *) "sample size (n)"}
+		     ,{'e', (char *) "epsilon",        -1, NULL,    ::TDOUBLE, (char *) "stop BB optimization when objective below number"}
 
-  calBT  btgen (instance, &calbb);
-  calbb. addCutGenerator (&btgen, 1, "Bound Reduction", true, false, false, 1);
-  calbb. cutGenerator (cgCnt++) -> setGlobalCuts (true);
+		     ,{'i', (char *) "lp-iter",        -1, NULL,    ::TINT,    (char *) "LP iterations in each BB run"}
+		     ,{'k', (char *) "iterations",    100, NULL,    ::TINT,    (char *) "number of BB runs in each replication"}
+		     ,{'b', (char *) "bb-nodes",       -1, NULL,    ::TINT,    (char *) "number of subproblems in each BB run"}
+		     ,{'t', (char *) "time",           -1, NULL,    ::TDOUBLE, (char *) "CPU time allotted to each BB run"}
+		     ,{'T', (char *) "tot-time",       -1, NULL,    ::TDOUBLE, (char *) "maximum total CPU time"}
 
-  CalCubeHeur calCube (calbb);
-  calCube. setCalModel (&calbb);
-  calCube. setInstance (instance);
-  calCube. setHeuristicName           ("Cube Method");
+		     ,{'R', (char *) "replications",    1, NULL,    ::TINT,    (char *) "number of replications (if \"-g\" chosen, it is ignored)"}
+		     ,{'s', (char *) "seed",           -1, NULL,    ::TINT,    (char *) "random seed (if not specified here or in input file, it is generated using time)"}
+		     ,{'f', (char *) "int-fixed",       1, NULL,    ::TDOUBLE, (char *) "portion of fixed variables before stopping flight phase of Cube"}
+		     ,{'o', (char *) "output",          0, NULL,    ::TSTRING, (char *) "output file"}
+		     ,{'O', (char *) "out-format",      0, NULL,    ::TSTRING, (char *) "output format: \"block\" for one unit per row, \"sparse\" for one selected unit per row, \"binary\", or \"row\" (default)"}
 
-  calbb. addHeuristic                (&calCube); // not necessary for now
+		     ,{'r', (char *) "random",          0, NULL,    ::TTOGGLE, (char *) "generate random initial point (overrides \"-g\" and \"-c\")"}
+		     ,{'c', (char *) "cube",            0, NULL,    ::TTOGGLE, (char *) "generate initial point through Cube"}
+		     ,{'g', (char *) "global",          0, NULL,    ::TTOGGLE, (char *) "find global optimum (overrides \"-c\")"}
 
-  // double objLimit;
-  // model.getDblParam (OsiDualObjectiveLimit, objLimit);
+		     ,{'L', (char *) "leverage",        0, NULL,    ::TTOGGLE, (char *) "branch on s variables ranked by their leverage on calibration"}
+		     ,{'P', (char *) "pscost-runs",     0, NULL,    ::TINT,    (char *) "number of Cube runs to seed pseudocosts of s variables (implies \"-L\")"}
+		     ,{'S', (char *) "semicont",        0, NULL,    ::TTOGGLE, (char *) "replace linking rows with semicontinuous branching objects"}
+		     ,{'D', (char *) "benders",         0, NULL,    ::TTOGGLE, (char *) "Benders decomposition: branch on s only, weights from cuts (ignores \"-L\", \"-P\", \"-S\")"}
+		     ,{'l', (char *) "light-cube",      0, NULL,    ::TTOGGLE, (char *) "Cube heuristic in BB computes weights directly, without nested BB"}
+		     ,{'F', (char *) "target-only",     0, NULL,    ::TTOGGLE, (char *) "only look for solutions below epsilon (uses its square root as BB cutoff)"}
+		     ,{'N', (char *) "no-presolve",     0, NULL,    ::TTOGGLE, (char *) "do not remove redundant calibration vectors nor presolve the root MILP"}
+		     ,{'K', (char *) "stall-pvalue",  .05, NULL,    ::TDOUBLE, (char *) "stop a replication when the estimated probability of improving in the next BB runs is below number (0: run all \"-k\" runs)"}
+		     ,{'Q', (char *) "pool-size",       0, NULL,    ::TINT,    (char *) "keep up to number distinct samples below epsilon found in BB, and use them in later replications"}
+		     ,{'u', (char *) "duplicates",      0, NULL,    ::TSTRING, (char *) "sample already output by a previous replication: \"reject\" it, \"reuse\" it and end the replication, or \"allow\" it (default)"}
+		     ,{'q', (char *) "quiet",           0, NULL,    ::TTOGGLE, (char *) "do not print sample and weights of each replication"}
+
+		     ,{'U', (char *) "daemon",          0, NULL,    ::TSTRING, (char *) "serve sampling requests on this Unix socket, for all instances given (see calDaemon.cpp)"}
+		     ,{'B', (char *) "batch",           0, NULL,    ::TSTRING, (char *) "solve all instances listed in this file, one per line, in a pipeline (see calBatch.cpp)"}
+		     ,{'J', (char *) "profile",         0, NULL,    ::TSTRING, (char *) "write the time spent in each phase of the solver, per replication and in total, to this JSON file (see calProfile.hpp)"}
+		     ,{'Z', (char *) "trace",           0, NULL,    ::TSTRING, (char *) "write a timeline of replications, BB runs, heuristics and cut rounds to this file, in Chrome trace format (see calTrace.hpp)"}
+		     ,{'H', (char *) "hw-counters",     0, NULL,    ::TTOGGLE, (char *) "print CPU cycles, instructions, cache and branch misses of each phase, and add them to the profiling report (see calPerf.hpp)"}
+		     ,{'I', (char *) "iter-project",    0, NULL,    ::TINT,    (char *) "project iteratively, with a random sketch as preconditioner, when the number of calibration vectors is at least this (0: never; see calIterProj.hpp)"}
 
-  OsiBabSolver solverChar;
-  solverChar. setSolverType (3);
+		     ,{'h', (char *) "help",            0, &needHelp, ::TTOGGLE, (char *) "print this help"}
 
-  //calbb. solver           () -> setAuxiliaryInfo (&solverChar);
-  //calbb. passInSolverCharacteristics             (&solverChar);
-  //calbb. continuousSolver () -> setAuxiliaryInfo (&solverChar);
+		     ,{0,   (char *) "",                0, NULL,    ::TTOGGLE,       (char *) ""} /* THIS ENTRY ALWAYS AT THE END */
+  };
 
-  if (instance -> maxIterations () >= 0) calbb.setMaximumNumberIterations (instance -> maxIterations ());
-  if (instance -> maxBBnodes    () >= 0) calbb.setMaximumNodes            (instance -> maxBBnodes ());
+  // default parameter values
 
-  if (!(instance -> outFile_)) {
-    instance -> outFile_ = (char *) malloc (sizeof (char) * strlen (argv [argc-1]) + 5);
-    strcpy (instance -> outFile_, strlen (argv [argc-1]) + 1, argv [argc-1]);
+  set_default_args (options);
 
-    char *exthook = strstr (instance -> outFile_, ".txt");
-    if (!exthook)
-      exthook = instance -> outFile_ + strlen (instance -> outFile_);
+  char *daemonSock = NULL;
 
-    strcpy (exthook, 5, ".sol");
+  char *manifest = NULL;
+
+  char *traceFile = NULL;
+
+  bool hwCounters = false;
+
+  options [26].par = &daemonSock; // after set_default_args, as they are NULL
+  options [27].par = &manifest;
+  options [29].par = &traceFile;
+  options [30].par = &hwCounters;
+
+  // parse command line
+
+  filenames = readargs (argc, argv, options);
+
+  if (traceFile) {
+    calTraceStart  (traceFile); // written at exit
+    calTraceThread ("main");
   }
 
-  printf ("Writing file %s\n", instance -> outFile_);
+  if (hwCounters)
+    calPerfStart ();
 
-  FILE *f;
+  if (needHelp) {
 
-#ifndef _MSC_VER
-  f = fopen   (instance -> outFile_, "w");
-#else
-  fopen_s (&f, instance -> outFile_, "w");
-#endif
+    printf ("\
+%s -- extract a calibrated sample\n\
+Synopsis: %s returns a set of samples of size n of a population U of size N.\n\
+The samples are calibrated w.r.t. a set of p auxiliary variable vectors.\n\
+Author: Pietro Belotti\n\
+Version: 0.1\n\
+License: Eclipse Public License\n\n", argv [0], argv [0]);
 
-  free (instance -> outFile_);
+    print_help (argv [0], options);
 
-  printf ("Generating point(s) (%gs)\n", CoinCpuTime ());
+    printf ("\n\
+Input file format as below:\n\
+\n\
+N 10 # cardinality of population U\n\
+n 3  # cardinality of sample S\n\
+p 4  # number of auxiliary variables\n\
+y 0 1 0 0 0 1 0 1 0 0 # initial solution (optional)\n\
+x 1 1 0 0 # auxiliary variables: N rows of p columns each\n\
+  0 0 1 0\n\
+  0 1 0 0\n\
+  0 0 0 1\n\
+  1 0 0 0\n\
+  0 1 0 0\n\
+  0 0 0 0\n\
+  0 0 1 1\n\
+  1 0 1 0\n\
+  0 1 0 0\n\
+I Pisa Parma Torino Roma Venezia Napoli Bari Palermo Bologna Milano\n\
+s 734642 # random seed (if -1 then generated using time)\n\
+\n\
+Output file format\nWithout option \"--out-format block\": for each replication, one line\n\
+containing the squared norm of (w-d), 0-1 vector with sample, and vector of weights.\n\
+\nWithout option \"--out-format block\": for each replication, one block of N lines.\n\
+Each line contains replication, function value, id, 0/1, and weight of each unit.\n\
+\nWith option \"--out-format sparse\": as above, for the n units in the sample only\n\
+and without the 0/1 column.\n\
+\nWith option \"--out-format binary\": a header and one fixed-size record per\n\
+replication, with the sample as a bitset and the weights of its units (see calOutput.hpp).\n\
+See user manual for mode details on input and output file formats.\n");
 
-  // if ((instance -> initType () == calInstance::LP_VALUE) &&   
-  //     (instance -> nReplications () != 1)) {
-  //   printf ("Initial weights set from LP but more than one repetition.\nResetting # repetitions to 1.\n");
-  //   instance -> nReplications () = 1;
-  // }
+    exit (0);
+  }
+
+  printf ("Calibri -- a solver for the optimal calibrated sampling problem\n");
 
-  //int nFails = 0;
-  //#define MAX_FAILS 20
+  if (daemonSock) {
 
-  // MAIN LOOP:
+    // all instances given are kept in memory, and requests name them
 
-  if (instance -> outFormat_ == calInstance::ROW_BASED) {
+    int nFiles = 0;
 
-    int N = instance -> N ();
+    while (filenames && filenames [nFiles])
+      ++nFiles;
 
-    fprintf (f, "%d,", N);
+    calInstance **instances = new calInstance * [nFiles];
 
-    for (int times=2; times--;) // do this for both binary and weight vector
+    for (int i=0; i<nFiles; ++i)
+      if (!(instances [i] = readInstance (filenames [i], options, argc, argv)))
+	exit (0);
 
-      for (int i=0; i<N; ++i)
-	if (instance -> id (i)) fprintf (f, "%s,", instance -> id (i));
-	else                    fprintf (f, "%d,", 1+i);
+    int retval = calDaemon (daemonSock, instances, nFiles, &GLOBAL_interrupt);
 
-    fprintf (f, "\n");
+    for (int i=0; i<nFiles; ++i) {
+      delete instances [i];
+      free (filenames [i]);
+    }
 
-  } else // first line of block
-    fprintf (f, "R,F,ID,S,W,\n");
+    delete [] instances;
+    free (filenames);
 
-  srand48 (instance -> randSeed ());
+    return retval;
+  }
 
-  for (int iter=0; iter < instance -> nReplications (); ++iter) {
+  if (manifest) {
 
-    if (GLOBAL_interrupt) {
+    // instances in the manifest, not on the command line
 
-      printf ("User interrupt\n");
-      break;
+    if (filenames) {
+      for (int i=0; filenames [i]; ++i)
+	free (filenames [i]);
+      free (filenames);
     }
 
-    printf ("-------------- Replication %d:\n", 1+iter);
+    // readInstance () re-reads the command line for each instance,
+    // in the parse thread: give it a copy of the options where -U,
+    // -B, -Z and -H, already read, no longer point to the strings in
+    // use here
+
+    tpar batchOptions [sizeof (options) / sizeof (tpar)];
+
+    memcpy (batchOptions, options, sizeof (options));
+
+    batchOptions [26].par =
+    batchOptions [27].par =
+    batchOptions [29].par =
+    batchOptions [30].par = NULL;
+
+    return (calBatchRun (manifest, batchOptions, argc, argv, &GLOBAL_interrupt) < 0) ? -1 : 0;
+  }
+
+  calInstance *instance = readInstance (*filenames, options, argc, argv);
+
+  if (!instance)
+    exit (0);
+
+  // delete filenames
+
+  if (filenames) {
+    for (int i=0; filenames [i]; ++i)
+      free (filenames [i]);
+    free (filenames);
+  }
 
-    if (!(calbb. search (calCube, f, iter)))
+  if (!(instance -> outFile_)) {
+    instance -> outFile_ = (char *) malloc (sizeof (char) * strlen (argv [argc-1]) + 5);
+    strcpy (instance -> outFile_, strlen (argv [argc-1]) + 1, argv [argc-1]);
 
-      printf ("Warning: no solution found at this replication.\n");
+    char *exthook = strstr (instance -> outFile_, ".txt");
+    if (!exthook)
+      exthook = instance -> outFile_ + strlen (instance -> outFile_);
 
-    // if ( || (nFails > MAX_FAILS) || (calInstance::GLOBAL == instance -> algType ())) {
-    //   ++iter;
-    //   nFails = 0;
-    // } else ++nFails;
+    strcpy (exthook, 5, ".sol");
   }
 
-  fclose (f);
+  printf ("Writing file %s\n", instance -> outFile_);
+
+  calOutput *out = new calOutput (instance, instance -> outFile_); // writes from a separate thread
+
+  free (instance -> outFile_);
+
+  int nSamples = calSolve (instance, out);
+
+  delete out; // waits for all samples to be written
+
+  printf ("%d sample(s) written\n", nSamples);
  
   if (instance) 
     delete instance;
@@ -6,6 +6,10 @@
  */
 
 #include "calModel.hpp"
+#include "calWeights.hpp"
+#include "calPool.hpp"
+#include "calProfile.hpp"
+#include "calSimd.hpp"
 
 //#define DEBUG
 
@@ -25,17 +29,78 @@ double calModel::checkSolution (double cutoff,
 
   int N = instance_ -> N ();
 
+  // Benders master: solution is (theta, s); get delta from the weight
+  // subproblem at the (rounded) sample
+
+  if (weights_) {
+
+    double
+      *delta = new double [N],
+      *s     = new double [N];
+
+    for (int i=0; i<N; ++i)
+      s [i] = floor (solution [1+i] + .5);
+
+    double f = weights_ -> solve (s, delta);
+
+    if ((pool_ || rejectSeen ()) && (f < COIN_DBL_MAX)) {
+
+      double *full = new double [1+2*N];
+
+      full [0] = f;
+      CoinCopyN (delta, N, full + 1);
+      CoinCopyN (s,     N, full + 1 + N);
+
+      if (rejectSeen () && (seen_ -> find (full) >= 0))
+	f = COIN_DBL_MAX;
+      else if (pool_)
+	pool_ -> offer (full, f);
+
+      delete [] full;
+    }
+
+    if (f < cutoff) {
+
+      if (!bestSol_)
+	bestSol_ = new double [1+2*N];
+
+      bestObj_ = f;
+      bestSol_ [0] = f;
+      CoinCopyN (delta, N, bestSol_ + 1);
+      CoinCopyN (s,     N, bestSol_ + 1 + N);
+    }
+
+    delete [] delta;
+    delete [] s;
+
+    return f;
+  }
+
   double 
-    sumDeltaSq = 0.,
     //	zCurrent  = solution [0],     // value of z, first variable and objective function
     *dCurrent = solution + 1; // pointer to first element of the delta subvector
 
+  // without linking rows in the LP, heuristics may return solutions
+  // with delta_i != 0 for an unselected unit: reject them
+
+  if (instance_ -> linkObjects ()) {
+
+    const double *sCurrent = solution + 1 + N;
+
+    for (int i=0; i<N; ++i)
+      if ((sCurrent [i] < .5) && (fabs (dCurrent [i]) > 1e-6))
+	return COIN_DBL_MAX;
+  }
+
+  if (rejectSeen () && (seen_ -> find (solution) >= 0))
+    return COIN_DBL_MAX;
+
   // check if cut violated
 
-  for (int i=0; i<N; ++i)
-    sumDeltaSq += dCurrent [i] * dCurrent [i];
+  double sumDeltaSq = sqrt (calSimd () -> sumSq (dCurrent, N));
 
-  sumDeltaSq = sqrt (sumDeltaSq);
+  if (pool_)
+    pool_ -> offer (solution, sumDeltaSq);
 
   if (sumDeltaSq < cutoff) {
 
@@ -60,12 +125,22 @@ void calModel::changeLU (OsiSolverInterface &si, double *s0) {
 
   int N = instance_ -> N ();
 
+  const double
+    *lb = si.getColLower (),
+    *ub = si.getColUpper ();
+
+  calProfTimer timer (instance_ -> profile (), PROF_CHANGELU);
+
+  // do not contradict bounds fixed by presolve
+
   for (int i=0; i<N; ++i) {
 
     double s0i = s0 [i];
 
-    if      (s0i <     1e-6) si.setColUpper (1 + N + i, 0.);
-    else if (s0i > 1 - 1e-6) si.setColLower (1 + N + i, 1.);
+    int j = instance_ -> sCol (i);
+
+    if      ((s0i <     1e-6) && (lb [j] < .5)) {si.setColUpper (j, 0.); timer. count (1);}
+    else if ((s0i > 1 - 1e-6) && (ub [j] > .5)) {si.setColLower (j, 1.); timer. count (1);}
   }
 
 #ifdef DEBUG
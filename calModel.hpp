@@ -12,6 +12,9 @@
 #include "calInstance.hpp"
 
 class CalCubeHeur;
+class calWeights;
+class calPool;
+class calOutput;
 
 class calModel: public CbcModel {
 
@@ -20,17 +23,28 @@ private:
   calInstance *instance_; ///< input data
   double      *bestSol_;  ///< keep solution from checksolution
   double       bestObj_;  ///< and its obj value
+  calWeights  *weights_;  ///< weight subproblem (Benders mode only), not owned
+  double       deadline_; ///< wall-clock time (see calClock.hpp) at which BB stops
+  calPool     *pool_;     ///< samples below eps, shared by all copies; not owned
+  calPool     *seen_;     ///< samples output by previous replications; not owned
+
+  bool rejectSeen ()
+  {return seen_ && (calInstance::DUP_REJECT == instance_ -> dupPolicy ());}
 
 public:
 
   calModel (const OsiSolverInterface &lp, calInstance *inst):
-    CbcModel (lp), instance_ (inst), bestSol_ (NULL), bestObj_ (1e40) {}
+    CbcModel (lp), instance_ (inst), bestSol_ (NULL), bestObj_ (1e40), weights_ (NULL), deadline_ (COIN_DBL_MAX), pool_ (NULL), seen_ (NULL) {}
 
   calModel (const calModel &rhs):
     CbcModel (rhs),
     instance_ (rhs.instance_),
-    bestSol_  (CoinCopyOfArray (rhs.bestSol_, 2 * rhs.instance_ -> N ())),
-    bestObj_  (rhs.bestObj_) {}
+    bestSol_  (CoinCopyOfArray (rhs.bestSol_, 1 + 2 * rhs.instance_ -> N ())),
+    bestObj_  (rhs.bestObj_),
+    weights_  (rhs.weights_),
+    deadline_ (rhs.deadline_),
+    pool_     (rhs.pool_),
+    seen_     (rhs.seen_) {}
 
   calModel *clone ()
   {return new calModel (*this);}
@@ -54,12 +68,26 @@ public:
   			int fixVariables, 
   			double originalObjValue);
 
+  /// in Benders mode, the solution is (theta, s) and bestSol_ is
+  /// filled in the usual (z, delta, s) layout
+  void setWeights (calWeights *w) {weights_ = w;}
+
+  /// every solution checked is offered to the pool
+  void setPool (calPool *pool) {pool_ = pool;}
+
+  /// samples already output; rejected by checkSolution if the
+  /// duplicate policy is "reject"
+  void setSeen (calPool *seen) {seen_ = seen;}
+
+  /// BB is stopped by calEventHandler when calWallTime () reaches this
+  double &deadline () {return deadline_;}
+
   const double *bestSol () {return bestSol_;}
   double bestObj () {return bestObj_;}
 
   void changeLU (OsiSolverInterface &si, double *s0); // fixes s variables based on s0
 
-  bool search (CalCubeHeur &calCube, FILE *f, int repl);
+  bool search (CalCubeHeur &calCube, calOutput *out, int repl);
 };
 
 #endif
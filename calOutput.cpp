@@ -0,0 +1,536 @@
+/*
+ * optimal calibrated sampling -- output of samples
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "calOutput.hpp"
+#include "calInstance.hpp"
+
+#ifdef _MSC_VER
+#define sprintf sprintf_s
+#endif
+
+static const double powTen [] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10};
+
+//
+// calOutBuffer
+//
+
+calOutBuffer::calOutBuffer ():
+
+  data_     (new char [OUT_INIT_SIZE]),
+  size_     (0),
+  capacity_ (OUT_INIT_SIZE) {}
+
+calOutBuffer::~calOutBuffer ()
+{delete [] data_;}
+
+void calOutBuffer::reserve (int more) {
+
+  if (size_ + more <= capacity_)
+    return;
+
+  while (size_ + more > capacity_)
+    capacity_ *= 2;
+
+  char *data = new char [capacity_];
+
+  memcpy (data, data_, size_);
+
+  delete [] data_;
+  data_ = data;
+}
+
+void calOutBuffer::putBytes (const void *p, int n) {
+
+  reserve (n);
+  memcpy (data_ + size_, p, n);
+  size_ += n;
+}
+
+void calOutBuffer::putChar (char c) {
+
+  reserve (1);
+  data_ [size_++] = c;
+}
+
+void calOutBuffer::putString (const char *s) {
+
+  int len = (int) strlen (s);
+
+  reserve (len);
+  memcpy (data_ + size_, s, len);
+  size_ += len;
+}
+
+void calOutBuffer::putInt (int i) {
+
+  char digits [12];
+  int  nDigits = 0;
+
+  unsigned int u = (i < 0) ? - (unsigned int) i : (unsigned int) i;
+
+  do {
+    digits [nDigits++] = (char) ('0' + u % 10);
+    u /= 10;
+  } while (u);
+
+  reserve (nDigits + 1);
+
+  if (i < 0)
+    data_ [size_++] = '-';
+
+  while (nDigits)
+    data_ [size_++] = digits [--nDigits];
+}
+
+// a * 10^k, for k in [-10,10]
+
+inline double scale10 (double a, int k)
+{return (k >= 0) ? a * powTen [k] : a / powTen [-k];}
+
+void calOutBuffer::putDouble (double x) {
+
+  if (x == 0.) {
+    putChar ('0');
+    return;
+  }
+
+  double a = fabs (x);
+
+  int e = 0, m = 0;
+
+  if ((a >= 1e-4) && (a < 1e6)) { // false if x is NaN
+
+    // six significant digits: m in [10^5, 10^6), a ~= m * 10^(e-5)
+
+    e = (int) floor (log10 (a));
+
+    if (e < -4) e = -4; // log10 may be off by one at powers of ten
+    if (e >  5) e =  5;
+
+    double scaled = scale10 (a, 5-e);
+
+    if      (scaled <  1e5) scaled = scale10 (a, 5 - --e);
+    else if (scaled >= 1e6) scaled = scale10 (a, 5 - ++e);
+
+    m = (int) floor (scaled + .5);
+
+    // scaled is not exact: leave near-ties to printf, which rounds
+    // the exact decimal value of x
+
+    if (fabs (scaled - floor (scaled) - .5) < 1e-6)
+      m = 0;
+
+    else if (m >= 1000000) { // rounded up to the next power of ten
+      m /= 10;
+      ++e;
+    }
+  }
+
+  if ((e < -4) || (e > 5) || (m < 100000) || (m >= 1000000)) {
+
+    // exponent notation, out of range, or near-tie
+
+    char str [32];
+    sprintf (str, "%g", x);
+    putString (str);
+    return;
+  }
+
+  char digits [6];
+
+  for (int k=5; k>=0; --k, m /= 10)
+    digits [k] = (char) ('0' + m % 10);
+
+  int last = 5; // last nonzero digit
+
+  while (digits [last] == '0')
+    --last;
+
+  reserve (16);
+
+  if (x < 0.)
+    data_ [size_++] = '-';
+
+  if (e >= 0) {
+
+    for (int k=0; k<=e; ++k)
+      data_ [size_++] = digits [k];
+
+    if (last > e) {
+
+      data_ [size_++] = '.';
+
+      for (int k=e+1; k<=last; ++k)
+	data_ [size_++] = digits [k];
+    }
+
+  } else {
+
+    data_ [size_++] = '0';
+    data_ [size_++] = '.';
+
+    for (int k=-1; k>e; --k)
+      data_ [size_++] = '0';
+
+    for (int k=0; k<=last; ++k)
+      data_ [size_++] = digits [k];
+  }
+}
+
+void calOutBuffer::putFixed (double x) {
+
+  char str [400]; // %f of 1e308 has 316 characters
+
+  sprintf (str, "%f", x);
+  putString (str);
+}
+
+//
+// calOutput
+//
+
+#ifdef _MSC_VER
+static DWORD WINAPI writerThread (LPVOID out) {
+  ((calOutput *) out) -> run ();
+  return 0;
+}
+#else
+static void *writerThread (void *out) {
+  ((calOutput *) out) -> run ();
+  return NULL;
+}
+#endif
+
+calOutput::calOutput (calInstance *inst, const char *filename):
+
+  instance_ (inst),
+  f_        (NULL),
+  head_     (0),
+  nQueued_  (0),
+  nFree_    (0),
+  stop_     (false),
+  async_    (false) {
+
+  const char *mode = (calInstance::BINARY == inst -> outFormat ()) ? "wb" : "w";
+
+#ifndef _MSC_VER
+  f_ = fopen   (filename, mode);
+#else
+  fopen_s (&f_, filename, mode);
+#endif
+
+  if (!f_) {
+    printf ("Error: cannot open %s for writing\n", filename);
+    return;
+  }
+
+#ifdef _MSC_VER
+  InitializeCriticalSection   (&lock_);
+  InitializeConditionVariable (&changed_);
+  thread_ = CreateThread (NULL, 0, writerThread, this, 0, NULL);
+  async_  = (thread_ != NULL);
+
+  if (!async_)
+    DeleteCriticalSection (&lock_);
+#else
+  pthread_mutex_init (&lock_,    NULL);
+  pthread_cond_init  (&changed_, NULL);
+  async_ = (0 == pthread_create (&thread_, NULL, writerThread, this));
+
+  if (!async_) {
+    pthread_cond_destroy  (&changed_);
+    pthread_mutex_destroy (&lock_);
+  }
+#endif
+
+  if (!async_)
+    printf ("Warning: cannot start writer thread, writing %s synchronously\n", filename);
+}
+
+calOutput::calOutput (calInstance *inst):
+
+  instance_ (inst),
+  f_        (NULL),
+  head_     (0),
+  nQueued_  (0),
+  nFree_    (0),
+  stop_     (false),
+  async_    (false) {}
+
+calOutput::~calOutput () {
+
+  if (f_) {
+
+    if (async_) {
+
+      lock ();
+      stop_ = true;
+      signal ();
+      unlock ();
+
+#ifdef _MSC_VER
+      WaitForSingleObject (thread_, INFINITE);
+      CloseHandle         (thread_);
+      DeleteCriticalSection (&lock_);
+#else
+      pthread_join          (thread_, NULL);
+      pthread_cond_destroy  (&changed_);
+      pthread_mutex_destroy (&lock_);
+#endif
+    }
+
+    fclose (f_);
+  }
+
+  while (nFree_)
+    delete free_ [--nFree_];
+}
+
+#ifdef _MSC_VER
+void calOutput::lock   () {EnterCriticalSection      (&lock_);}
+void calOutput::unlock () {LeaveCriticalSection      (&lock_);}
+void calOutput::wait   () {SleepConditionVariableCS  (&changed_, &lock_, INFINITE);}
+void calOutput::signal () {WakeAllConditionVariable  (&changed_);}
+#else
+void calOutput::lock   () {pthread_mutex_lock     (&lock_);}
+void calOutput::unlock () {pthread_mutex_unlock   (&lock_);}
+void calOutput::wait   () {pthread_cond_wait      (&changed_, &lock_);}
+void calOutput::signal () {pthread_cond_broadcast (&changed_);}
+#endif
+
+calOutBuffer *calOutput::buffer () {
+
+  calOutBuffer *buf = NULL;
+
+  if (async_) {
+    lock ();
+    if (nFree_)
+      buf = free_ [--nFree_];
+    unlock ();
+  } else if (nFree_)
+    buf = free_ [--nFree_];
+
+  return buf ? buf : new calOutBuffer;
+}
+
+void calOutput::submit (calOutBuffer *buf) {
+
+  if (!f_) { // nowhere to write: just recycle
+    recycle (buf);
+    return;
+  }
+
+  if (!async_) { // no writer thread: write it here
+    fwrite (buf -> data (), 1, buf -> size (), f_);
+    fflush (f_);
+    recycle (buf);
+    return;
+  }
+
+  lock ();
+
+  while (nQueued_ == OUT_MAX_PENDING)
+    wait ();
+
+  queue_ [(head_ + nQueued_++) % OUT_MAX_PENDING] = buf;
+
+  signal ();
+  unlock ();
+}
+
+// writer thread: write buffers in FIFO order until the destructor
+// asks to stop and the queue is empty
+
+void calOutput::run () {
+
+  lock ();
+
+  for (;;) {
+
+    while (!nQueued_ && !stop_)
+      wait ();
+
+    if (!nQueued_)
+      break;
+
+    calOutBuffer *buf = queue_ [head_];
+
+    head_ = (head_ + 1) % OUT_MAX_PENDING;
+    --nQueued_;
+
+    signal (); // room in the queue
+
+    unlock ();
+
+    fwrite (buf -> data (), 1, buf -> size (), f_);
+    fflush (f_);
+
+    lock ();
+
+    recycle (buf);
+  }
+
+  unlock ();
+}
+
+void calOutput::recycle (calOutBuffer *buf) {
+
+  buf -> clear ();
+
+  if (nFree_ < OUT_MAX_PENDING + 2) free_ [nFree_++] = buf;
+  else                              delete buf;
+}
+
+void calOutput::writeHeader () {
+
+  calOutBuffer *buf = buffer ();
+
+  if (instance_ -> outFormat () == calInstance::ROW_BASED) {
+
+    int N = instance_ -> N ();
+
+    buf -> putInt (N);
+    buf -> putChar (',');
+
+    for (int times=2; times--;) // do this for both binary and weight vector
+
+      for (int i=0; i<N; ++i) {
+
+	if (instance_ -> id (i)) buf -> putString (instance_ -> id (i));
+	else                     buf -> putInt    (1+i);
+
+	buf -> putChar (',');
+      }
+
+    buf -> putChar ('\n');
+
+  } else if (instance_ -> outFormat () == calInstance::BINARY) {
+
+    int header [6] = {OUT_BIN_VERSION, 0x01020304, instance_ -> N (), instance_ -> n (),
+		      nBinWords (), binRecordSize ()};
+
+    buf -> putBytes (OUT_BIN_MAGIC, 8);
+    buf -> putBytes (header, sizeof (header));
+
+  } else if (instance_ -> outFormat () == calInstance::SPARSE)
+    buf -> putString ("R,F,ID,W,\n");
+
+  else // first line of block
+    buf -> putString ("R,F,ID,S,W,\n");
+
+  submit (buf);
+}
+
+int calOutput::nBinWords () const {
+
+  int nWords = (instance_ -> N () + 31) / 32;
+
+  return nWords + (nWords & 1);
+}
+
+int calOutput::binRecordSize () const
+{return 2 * sizeof (int) + sizeof (double) * (1 + instance_ -> n ()) + sizeof (unsigned int) * nBinWords ();}
+
+void calOutput::writeSample (int repl, double obj, const double *sol) {
+
+  int N = instance_ -> N ();
+
+  double w0 = (double) N / instance_ -> n ();
+
+  const double
+    *delta = sol + 1,
+    *s     = sol + 1 + N;
+
+  calOutBuffer *buf = buffer ();
+
+  if (instance_ -> outFormat () == calInstance::ROW_BASED) {
+
+    buf -> putFixed (obj);
+    buf -> putChar (',');
+
+    for (int i=0; i<N; ++i)
+      buf -> putString ((fabs (s [i]) > 1e-6) ? "1," : "0,");
+
+    for (int i=0; i<N; ++i) {
+      buf -> putDouble (w0 + delta [i]);
+      buf -> putChar (',');
+    }
+
+    buf -> putChar ('\n');
+
+  } else if (instance_ -> outFormat () == calInstance::SPARSE) {
+
+    for (int i=0; i<N; ++i)
+
+      if (fabs (s [i]) > 1e-6) {
+
+	buf -> putInt    (1 + repl);        buf -> putChar (',');
+	buf -> putDouble (obj);             buf -> putChar (',');
+
+	if (instance_ -> id (i)) buf -> putString (instance_ -> id (i));
+	else                     buf -> putInt    (1+i);
+
+	buf -> putChar   (',');
+	buf -> putDouble (w0 + delta [i]);  buf -> putString (",\n");
+      }
+
+  } else if (instance_ -> outFormat () == calInstance::BINARY) {
+
+    int
+      n      = instance_ -> n (),
+      nWords = nBinWords (),
+      nSel   = 0;
+
+    unsigned int *bits = new unsigned int [nWords];
+    double       *w    = new double       [n];
+
+    for (int k=0; k<nWords; ++k)
+      bits [k] = 0;
+
+    for (int k=0; k<n; ++k)
+      w [k] = 0.;
+
+    for (int i=0; i<N; ++i)
+      if (fabs (s [i]) > 1e-6) {
+
+	bits [i / 32] |= (1u << (i % 32));
+
+	if (nSel < n)
+	  w [nSel++] = w0 + delta [i];
+      }
+
+    int first [2] = {1 + repl, nSel};
+
+    buf -> putBytes (first, sizeof (first));
+    buf -> putBytes (&obj,  sizeof (double));
+    buf -> putBytes (bits,  nWords * sizeof (unsigned int));
+    buf -> putBytes (w,     n      * sizeof (double));
+
+    delete [] bits;
+    delete [] w;
+
+  } else {
+
+    for (int i=0; i<N; ++i) {
+
+      buf -> putInt    (1 + repl);        buf -> putChar (',');
+      buf -> putDouble (obj);             buf -> putChar (',');
+
+      if (instance_ -> id (i)) buf -> putString (instance_ -> id (i));
+      else                     buf -> putInt    (1+i);
+
+      buf -> putString ((fabs (s [i]) > 1e-6) ? ",1," : ",0,");
+      buf -> putDouble (w0 + delta [i]);  buf -> putString (",\n");
+    }
+  }
+
+  submit (buf);
+}
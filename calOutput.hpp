@@ -0,0 +1,153 @@
+/*
+ * optimal calibrated sampling -- output of samples
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calOutput_hpp
+#define calOutput_hpp
+
+#include <stdio.h>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+class calInstance;
+
+#define OUT_MAX_PENDING 4       // max buffers waiting to be written (more: search waits)
+#define OUT_INIT_SIZE   (1<<16) // initial size of a buffer
+
+#define OUT_BIN_MAGIC   "CALIBRI"  // first 8 bytes of a binary file, with the final '\0'
+#define OUT_BIN_VERSION 1
+
+//
+// Growable character buffer with fast formatting of numbers. Integers
+// are converted digit by digit; doubles in [1e-4,1e6) are written as
+// printf's %g would (six significant digits, no trailing zeros), all
+// others through snprintf.
+//
+
+class calOutBuffer {
+
+protected:
+
+  char *data_;
+  int   size_;
+  int   capacity_;
+
+  void reserve (int more); ///< make room for more characters
+
+public:
+
+  calOutBuffer ();
+  ~calOutBuffer ();
+
+  void clear () {size_ = 0;}
+
+  const char *data () const {return data_;}
+  int         size () const {return size_;}
+
+  void putBytes  (const void *p, int n);
+  void putChar   (char c);
+  void putString (const char *s);
+  void putInt    (int i);
+  void putDouble (double x); ///< as %g
+  void putFixed  (double x); ///< as %f
+};
+
+//
+// Writer of the .sol file. Each replication fills a buffer, which is
+// handed to a background thread that writes it and gives it back for
+// reuse; the solver thus never waits for the disk unless more than
+// OUT_MAX_PENDING buffers are queued. Buffers are written in the
+// order they are submitted, and the file is flushed after each. The
+// destructor writes all pending buffers and closes the file. If the
+// thread cannot be started, buffers are written by submit () instead.
+//
+// Binary format (-O binary), in the byte order of the writer, for
+// readers that mmap the file: a header of eight 4-byte fields
+//
+//   char  magic [8]   OUT_BIN_MAGIC
+//   int   version     OUT_BIN_VERSION
+//   int   byteOrder   0x01020304 as written by the writer
+//   int   N, n
+//   int   nWords      4-byte words in the bitset of a sample (even)
+//   int   recordSize  bytes in each record
+//
+// then one record per replication, with all doubles 8-byte aligned:
+//
+//   int          repl       replication (from 1)
+//   int          nSelected  units in the sample (n)
+//   double       obj        ||delta||^2
+//   unsigned int bits [nWords]  bit i%32 of word i/32 set if unit i selected
+//   double       w [n]      weights of the selected units, by increasing index
+//
+
+class calOutput {
+
+protected:
+
+  calInstance *instance_;
+  FILE        *f_;
+
+  calOutBuffer *queue_ [OUT_MAX_PENDING]; ///< FIFO of buffers to be written
+  int           head_;
+  int           nQueued_;
+
+  calOutBuffer *free_  [OUT_MAX_PENDING + 2]; ///< buffers written, ready for reuse
+  int           nFree_;
+
+  bool          stop_;  ///< set by the destructor: write what is left and exit
+  bool          async_; ///< writer thread running; if not, submit () writes
+
+#ifdef _MSC_VER
+  HANDLE             thread_;
+  CRITICAL_SECTION   lock_;
+  CONDITION_VARIABLE changed_;
+#else
+  pthread_t          thread_;
+  pthread_mutex_t    lock_;
+  pthread_cond_t     changed_;
+#endif
+
+  int nBinWords     () const; ///< binary format: words in the bitset of a sample
+  int binRecordSize () const; ///< binary format: bytes in a record
+
+  void recycle (calOutBuffer *buf); ///< clear buf and keep it for reuse (lock held if async_)
+
+  void lock   ();
+  void unlock ();
+  void wait   ();
+  void signal ();
+
+public:
+
+  calOutput (calInstance *inst, const char *filename);
+  calOutput (calInstance *inst); ///< no file, for classes that redefine writeHeader () and writeSample ()
+
+  virtual ~calOutput ();
+
+  bool isOpen () const {return (f_ != NULL);}
+
+  /// empty buffer, either new or already written
+  calOutBuffer *buffer ();
+
+  /// queue buffer to be written; it must not be used afterwards
+  void submit (calOutBuffer *buf);
+
+  /// first line(s) of the file, depending on the output format
+  virtual void writeHeader ();
+
+  /// sample of replication repl, in the (z, delta, s) layout, of value
+  /// obj = ||delta||^2
+  virtual void writeSample (int repl, double obj, const double *sol);
+
+  /// body of the writer thread
+  void run ();
+};
+
+#endif
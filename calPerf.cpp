@@ -0,0 +1,195 @@
+/*
+ * optimal calibrated sampling -- hardware performance counters
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdio.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "calPerf.hpp"
+
+const char *calPerfName [PERF_NCOUNTERS] = {
+  "cycles",
+  "instructions",
+  "llc_misses",
+  "branch_misses"
+};
+
+volatile bool calPerfOn = false;
+
+#ifdef __linux__
+
+static const unsigned long long perfConfig [PERF_NCOUNTERS] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES, // last level on most CPUs
+  PERF_COUNT_HW_BRANCH_MISSES
+};
+
+// the counters of a thread, as one group, read at once
+
+struct calPerfGroup {
+
+  int leader;                ///< fd of the first counter opened, -1 if none
+  int nOpen;
+  int slot [PERF_NCOUNTERS]; ///< position in the group, -1 if not opened
+  int error;                 ///< errno of the first failure
+};
+
+static __thread calPerfGroup *myGroup = NULL;
+
+static calPerfGroup *group () {
+
+  if (!myGroup) {
+
+    calPerfGroup *g = new calPerfGroup;
+
+    g -> leader = -1;
+    g -> nOpen  = 0;
+    g -> error  = 0;
+
+    for (int i=0; i<PERF_NCOUNTERS; ++i) {
+
+      struct perf_event_attr attr;
+
+      memset (&attr, 0, sizeof (attr));
+
+      attr. type           = PERF_TYPE_HARDWARE;
+      attr. size           = sizeof (attr);
+      attr. config         = perfConfig [i];
+      attr. disabled       = (g -> leader < 0); // the group starts with its leader
+      attr. exclude_kernel = 1;
+      attr. exclude_hv     = 1;
+      attr. read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      int fd = (int) syscall (__NR_perf_event_open, &attr, 0, -1, g -> leader, 0); // this thread, any CPU
+
+      if (fd < 0) {
+	if (!(g -> error)) g -> error = errno;
+	g -> slot [i] = -1;
+	continue;
+      }
+
+      if (g -> leader < 0)
+	g -> leader = fd;
+
+      g -> slot [i] = g -> nOpen++;
+    }
+
+    if (g -> leader >= 0) {
+      ioctl (g -> leader, PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+      ioctl (g -> leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    myGroup = g;
+  }
+
+  return myGroup;
+}
+
+bool calPerfRead (long long *v) {
+
+  for (int i=0; i<PERF_NCOUNTERS; ++i)
+    v [i] = -1;
+
+  calPerfGroup *g = group ();
+
+  if (g -> leader < 0)
+    return false;
+
+  // number of counters, time enabled, time running, values
+
+  unsigned long long buf [3 + PERF_NCOUNTERS];
+
+  if (read (g -> leader, buf, sizeof (buf)) < (ssize_t) ((3 + g -> nOpen) * sizeof (*buf)))
+    return false;
+
+  // when the PMU is shared, the group only counts part of the time:
+  // scale as perf-stat does
+
+  double scale = (buf [2] > 0) ? (double) buf [1] / buf [2] : 1.;
+
+  for (int i=0; i<PERF_NCOUNTERS; ++i)
+    if (g -> slot [i] >= 0)
+      v [i] = (long long) (scale * buf [3 + g -> slot [i]]);
+
+  return true;
+}
+
+bool calPerfStart () {
+
+  calPerfGroup *g = group ();
+
+  if (g -> leader < 0) {
+    printf ("Hardware counters not available (%s), continuing without\n", strerror (g -> error));
+    return false;
+  }
+
+  for (int i=0; i<PERF_NCOUNTERS; ++i)
+    if (g -> slot [i] < 0)
+      printf ("Warning: hardware counter %s not available\n", calPerfName [i]);
+
+  calPerfOn = true;
+
+  return true;
+}
+
+#else
+
+bool calPerfRead (long long *v) {
+
+  for (int i=0; i<PERF_NCOUNTERS; ++i)
+    v [i] = -1;
+
+  return false;
+}
+
+bool calPerfStart () {
+
+  printf ("Hardware counters not available on this system, continuing without\n");
+  return false;
+}
+
+#endif
+
+bool calPerfMark::delta (long long *d) const {
+
+  if (!ok_ || !calPerfRead (d))
+    return false;
+
+  for (int i=0; i<PERF_NCOUNTERS; ++i)
+    d [i] = ((d [i] < 0) || (start_ [i] < 0)) ? -1 : d [i] - start_ [i];
+
+  return true;
+}
+
+void calPerfMark::print () const {
+
+  long long d [PERF_NCOUNTERS];
+
+  if (!delta (d))
+    return;
+
+  printf (" [");
+
+  for (int i=0; i<PERF_NCOUNTERS; ++i) {
+
+    if (d [i] < 0) printf ("%s%s n/a",  i ? ", " : "", calPerfName [i]);
+    else           printf ("%s%s %lld", i ? ", " : "", calPerfName [i], d [i]);
+
+    if ((PERF_INSTRUCTIONS == i) && (d [PERF_CYCLES] > 0) && (d [i] >= 0))
+      printf (" (IPC %.2f)", (double) d [i] / d [PERF_CYCLES]);
+  }
+
+  printf ("]");
+}
@@ -0,0 +1,73 @@
+/*
+ * optimal calibrated sampling -- hardware performance counters
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calPerf_hpp
+#define calPerf_hpp
+
+//
+// Hardware counters (option -H): CPU cycles, instructions, last-level
+// cache misses, and branch mispredictions of the calling thread, read
+// through perf_event_open on Linux. With -H, the phases that calibri
+// prints (reading the instance, building the root MILP, each BB run)
+// are followed by their counters, and with -J the profiling report
+// has the counters of each phase, including the flight phase and the
+// projection, next to its time.
+//
+// Each thread opens its counters at its first read. If they cannot be
+// opened, as in containers without access to the PMU or on other
+// systems, calPerfStart () says so and calibri runs without them; a
+// counter that the CPU does not have is reported as -1 (n/a).
+//
+
+#define PERF_NCOUNTERS 4
+
+enum calPerfCounter {
+
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_LLC_MISSES,
+  PERF_BRANCH_MISSES
+};
+
+/// names of the counters, as in the profiling report
+extern const char *calPerfName [PERF_NCOUNTERS];
+
+/// true once calPerfStart () has opened the counters
+extern volatile bool calPerfOn;
+
+/// enable the counters; false, with a message, if not available
+bool calPerfStart ();
+
+/// counts of the calling thread so far (-1: not available); false if
+/// none is
+bool calPerfRead (long long *v);
+
+//
+// Counters since its creation
+//
+
+class calPerfMark {
+
+protected:
+
+  long long start_ [PERF_NCOUNTERS];
+  bool      ok_;
+
+public:
+
+  /// reads the counters if enabled and on is true
+  calPerfMark (bool on = true):
+    ok_ (on && calPerfOn && calPerfRead (start_)) {}
+
+  /// counts since creation (-1: not available); false if none
+  bool delta (long long *d) const;
+
+  /// print " [cycles ..., ...]" if the counters are available
+  void print () const;
+};
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * optimal calibrated sampling -- pool of samples
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <OsiSolverInterface.hpp>
+#include <CoinHelperFunctions.hpp>
+#include <CoinFinite.hpp>
+
+#include "calPool.hpp"
+#include "calInstance.hpp"
+
+//#define DEBUG
+
+#define BITS_PER_WORD (8 * (int) sizeof (unsigned int))
+
+calPool::calPool (calInstance *inst, int capacity, double threshold):
+
+  instance_   (inst),
+  N_          (inst -> N ()),
+  n_          (inst -> n ()),
+  nWords_     ((inst -> N () + BITS_PER_WORD - 1) / BITS_PER_WORD),
+  capacity_   (capacity),
+  size_       (0),
+  threshold_  (threshold),
+  nOffered_   (0),
+  nDuplicate_ (0),
+  nDrawn_     (0) {
+
+  bits_    = new unsigned int * [capacity_];
+  weights_ = new double       * [capacity_];
+  obj_     = new double         [capacity_];
+  used_    = new bool           [capacity_];
+  scratch_ = new unsigned int   [nWords_];
+}
+
+calPool::~calPool () {
+
+  for (int k=0; k<size_; ++k) {
+    delete [] bits_    [k];
+    delete [] weights_ [k];
+  }
+
+  delete [] bits_;
+  delete [] weights_;
+  delete [] obj_;
+  delete [] used_;
+  delete [] scratch_;
+}
+
+// s (rounded) to bitset; returns the number of units in it
+
+int calPool::pack (const double *s, unsigned int *bits) const {
+
+  int card = 0;
+
+  CoinZeroN (bits, nWords_);
+
+  for (int i=0; i<N_; ++i)
+    if (s [i] > .5) {
+      bits [i / BITS_PER_WORD] |= (1u << (i % BITS_PER_WORD));
+      ++card;
+    }
+
+  return card;
+}
+
+// FNV-1a on the bytes of the bitset
+
+unsigned int calPool::hash (const unsigned int *bits) const {
+
+  unsigned int h = 2166136261u;
+
+  const unsigned char *byte = (const unsigned char *) bits;
+
+  for (int k = 0, kEnd = nWords_ * (int) sizeof (unsigned int); k < kEnd; ++k) {
+    h ^= byte [k];
+    h *= 16777619u;
+  }
+
+  return h;
+}
+
+int calPool::lookup (const unsigned int *bits, unsigned int h) const {
+
+  std::pair <std::multimap <unsigned int, int>::const_iterator,
+	     std::multimap <unsigned int, int>::const_iterator> range = index_. equal_range (h);
+
+  for (std::multimap <unsigned int, int>::const_iterator it = range.first; it != range.second; ++it)
+    if (!memcmp (bits_ [it -> second], bits, nWords_ * sizeof (unsigned int)))
+      return it -> second;
+
+  return -1;
+}
+
+// Offer a solution of value obj = ||delta||_2
+
+bool calPool::offer (const double *sol, double obj) {
+
+  if ((capacity_ <= 0) || (obj * obj > threshold_))
+    return false;
+
+  ++nOffered_;
+
+  const double
+    *delta = sol + 1,
+    *s     = sol + 1 + N_;
+
+  // a sample of another size (from a solution not quite integer) has
+  // no place here: all of them have n_ weights
+
+  if (pack (s, scratch_) != n_)
+    return false;
+
+  unsigned int h = hash (scratch_);
+
+  int pos = lookup (scratch_, h);
+
+  if (pos >= 0) {
+
+    ++nDuplicate_;
+
+    // same sample, keep the better weights
+
+    if (obj < obj_ [pos]) {
+
+      obj_ [pos] = obj;
+
+      for (int i=0, k=0; (i<N_) && (k<n_); ++i)
+	if (s [i] > .5)
+	  weights_ [pos] [k++] = (double) N_ / n_ + delta [i];
+    }
+
+    return false;
+  }
+
+  if (size_ < capacity_)
+
+    pos = size_++;
+
+  else {
+
+    // full: replace the worst sample, if worse than this one
+
+    pos = 0;
+
+    for (int k=1; k<size_; ++k)
+      if (obj_ [k] > obj_ [pos])
+	pos = k;
+
+    if (obj_ [pos] <= obj)
+      return false;
+
+    unsigned int hOld = hash (bits_ [pos]);
+
+    std::pair <std::multimap <unsigned int, int>::iterator,
+	       std::multimap <unsigned int, int>::iterator> range = index_. equal_range (hOld);
+
+    for (std::multimap <unsigned int, int>::iterator it = range.first; it != range.second; ++it)
+      if (it -> second == pos) {
+	index_. erase (it);
+	break;
+      }
+
+    delete [] bits_    [pos];
+    delete [] weights_ [pos];
+  }
+
+  bits_    [pos] = CoinCopyOfArray (scratch_, nWords_);
+  weights_ [pos] = new double [n_];
+  obj_     [pos] = obj;
+  used_    [pos] = false;
+
+  for (int i=0, k=0; (i<N_) && (k<n_); ++i)
+    if (s [i] > .5)
+      weights_ [pos] [k++] = (double) N_ / n_ + delta [i];
+
+  index_. insert (std::pair <unsigned int, int> (h, pos));
+
+#ifdef DEBUG
+  printf ("pool: added sample %d with value %g (hash %x)\n", pos, obj * obj, h);
+#endif
+
+  return true;
+}
+
+// Position of the sample of sol in the pool, or -1
+
+int calPool::find (const double *sol) {
+
+  pack (sol + 1 + N_, scratch_);
+
+  return lookup (scratch_, hash (scratch_));
+}
+
+// Copy the sample at position pos into sol
+
+double calPool::get (int pos, double *sol) {
+
+  double w0 = (double) N_ / n_;
+
+  sol [0] = obj_ [pos];
+
+  for (int i=0, k=0; i<N_; ++i)
+
+    if ((k < n_) && (bits_ [pos] [i / BITS_PER_WORD] & (1u << (i % BITS_PER_WORD)))) {
+
+      sol [1 + N_ + i] = 1.;
+      sol [1      + i] = weights_ [pos] [k++] - w0;
+
+    } else {
+
+      sol [1 + N_ + i] = 0.;
+      sol [1      + i] = 0.;
+    }
+
+  return obj_ [pos];
+}
+
+// Copy the best sample not yet used into sol
+
+double calPool::draw (double *sol) {
+
+  int pos = -1;
+
+  for (int k=0; k<size_; ++k)
+    if (!(used_ [k]) && ((pos < 0) || (obj_ [k] < obj_ [pos])))
+      pos = k;
+
+  if (pos < 0)
+    return COIN_DBL_MAX;
+
+  used_ [pos] = true;
+  ++nDrawn_;
+
+  return get (pos, sol);
+}
+
+// Add a no-good row for each sample in the pool
+
+void calPool::addNoGoods (OsiSolverInterface &si) {
+
+  int    *ind  = new int    [n_];
+  double *ones = new double [n_];
+
+  CoinFillN (ones, n_, 1.);
+
+  for (int k=0; k<size_; ++k) {
+
+    int nnz = 0;
+
+    for (int i=0; (i<N_) && (nnz<n_); ++i)
+      if (bits_ [k] [i / BITS_PER_WORD] & (1u << (i % BITS_PER_WORD)))
+	ind [nnz++] = instance_ -> sCol (i);
+
+    si.addRow (CoinPackedVector (nnz, ind, ones), -COIN_DBL_MAX, nnz - 1.);
+  }
+
+  delete [] ind;
+  delete [] ones;
+}
+
+// Mark the sample of sol as used, if it is in the pool
+
+void calPool::markUsed (const double *sol) {
+
+  int pos = find (sol);
+
+  if (pos >= 0)
+    used_ [pos] = true;
+}
+
+void calPool::print (const char *name) {
+
+  int nUsed = 0;
+
+  for (int k=0; k<size_; ++k)
+    if (used_ [k])
+      ++nUsed;
+
+  printf ("%s: %d samples (%d used, %d drawn by replications), %d offered, %d duplicates\n",
+	  name, size_, nUsed, nDrawn_, nOffered_, nDuplicate_);
+}
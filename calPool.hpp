@@ -0,0 +1,92 @@
+/*
+ * optimal calibrated sampling -- pool of samples
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calPool_hpp
+#define calPool_hpp
+
+#include <map>
+
+class calInstance;
+class OsiSolverInterface;
+
+//
+// Bounded pool of distinct samples whose objective ||delta||^2 is
+// below a threshold. Each sample is kept as a bitset of the selected
+// units plus the weights of these units, and is found through a hash
+// of the bitset. All solutions passed to calModel::checkSolution ()
+// are offered to the pool, not only those that improve the incumbent,
+// and replications draw from it before running any BB (option -Q).
+// When the pool is full, a new sample replaces the worst one if it is
+// better.
+//
+// The same class, with no threshold, keeps the samples output by
+// all replications so far, to detect duplicates (option -u).
+//
+
+class calPool {
+
+protected:
+
+  calInstance *instance_;
+
+  int      N_;
+  int      n_;
+  int      nWords_;     ///< words per bitset
+  int      capacity_;
+  int      size_;
+  double   threshold_;  ///< only accept samples with ||delta||^2 <= threshold_
+
+  unsigned int **bits_;    ///< bitset of each sample
+  double       **weights_; ///< weights of the selected units, by increasing index
+  double        *obj_;     ///< ||delta||_2 of each sample
+  bool          *used_;    ///< already output by a replication
+
+  unsigned int  *scratch_; ///< bitset workspace
+
+  std::multimap <unsigned int, int> index_; ///< hash -> position in the pool
+
+  int      nOffered_;   ///< statistics
+  int      nDuplicate_;
+  int      nDrawn_;
+
+  int          pack   (const double *s, unsigned int *bits) const; ///< s (rounded) to bitset; returns its cardinality
+  unsigned int hash   (const unsigned int *bits) const;            ///< FNV-1a
+  int          lookup (const unsigned int *bits, unsigned int h) const;
+
+public:
+
+  calPool  (calInstance *inst, int capacity, double threshold);
+  ~calPool ();
+
+  int size () {return size_;}
+
+  /// Offer a solution (z, delta, s layout) of value obj = ||delta||_2.
+  /// Returns true if it was added
+  bool offer (const double *sol, double obj);
+
+  /// Position of the sample of sol in the pool, or -1
+  int find (const double *sol);
+
+  /// Copy the sample at position pos into sol (z, delta, s layout).
+  /// Returns its value
+  double get (int pos, double *sol);
+
+  /// Copy the best sample not yet used into sol (z, delta, s layout)
+  /// and mark it used. Returns its value, or COIN_DBL_MAX if none
+  double draw (double *sol);
+
+  /// Add a no-good row sum_{i: s_i = 1} s_i <= n-1 to si for each
+  /// sample in the pool
+  void addNoGoods (OsiSolverInterface &si);
+
+  /// Mark the sample of sol as used, if it is in the pool
+  void markUsed (const double *sol);
+
+  void print (const char *name = "Solution pool");
+};
+
+#endif
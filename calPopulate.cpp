@@ -17,8 +17,6 @@
 
 //#define DEBUG
 
-#define EPS_W 1e-2
-
 /*
  * Building model
  */
@@ -31,8 +29,12 @@ int populate (calInstance *instance, OsiSolverInterface *problem) {
    *   - objective function
    *   - cardinality constraint
    *   - n+1 essential conic constraints
+   *   - 2N linking constraints, unless they are replaced by
+   *     semicontinuous branching objects (see calBranch.hpp)
    */
 
+  bool linkRows = !(instance -> linkObjects ());
+
   int
     N = instance -> N (),
     n = instance -> n (),
@@ -40,7 +42,7 @@ int populate (calInstance *instance, OsiSolverInterface *problem) {
 
     nPoints = 2*N, // only add them along coordinate axes -- 1+N if approx cone
     nvars = 1 + 2*N,
-    ncons = nPoints + 2 + p + 2*N,
+    ncons = nPoints + 2 + p + (linkRows ? 2*N : 0),
     nnz   = 2*p*N + 7*N + nPoints * (1+N),
 
     *mcnt  = (int    *) malloc (nvars     * sizeof (int)),
@@ -165,11 +167,14 @@ int populate (calInstance *instance, OsiSolverInterface *problem) {
 	  mval [nnz++] = elements [j] [cursor [j]++];
 	}
 
-    mind [nnz]   = nPoints+2+p+i;
-    mval [nnz++] = 1;
+    if (linkRows) {
 
-    mind [nnz]   = nPoints+2+p+N+i;
-    mval [nnz++] = 1;
+      mind [nnz]   = nPoints+2+p+i;
+      mval [nnz++] = 1;
+
+      mind [nnz]   = nPoints+2+p+N+i;
+      mval [nnz++] = 1;
+    }
 
     mcnt [1+i] = nnz - mbeg [1+i];
   }
@@ -207,11 +212,14 @@ int populate (calInstance *instance, OsiSolverInterface *problem) {
 	mval [nnz++] = (double) N / n * elements [j] [cursor [j]++];
       }
 
-    mind [nnz]   = nPoints+2+p+i;
-    mval [nnz++] = w0;
+    if (linkRows) {
+
+      mind [nnz]   = nPoints+2+p+i;
+      mval [nnz++] = w0;
 
-    mind [nnz]   = nPoints+2+p+N+i;
-    mval [nnz++] = w0 - U;
+      mind [nnz]   = nPoints+2+p+N+i;
+      mval [nnz++] = w0 - U;
+    }
 
     mcnt [1+N+i] = nnz - mbeg [1+i];
   }
@@ -262,10 +270,11 @@ int populate (calInstance *instance, OsiSolverInterface *problem) {
     rlb [nPoints+2+i] = rub [nPoints+2+i] = sumX;
   }
 
-  for (int i=0; i<N; ++i) {
-    rlb [nPoints+2+p+i]   = 0;             rub [nPoints+2+p+i]   = COIN_DBL_MAX;
-    rlb [nPoints+2+p+N+i] = -COIN_DBL_MAX; rub [nPoints+2+p+N+i] = 0;
-  }
+  if (linkRows)
+    for (int i=0; i<N; ++i) {
+      rlb [nPoints+2+p+i]   = 0;             rub [nPoints+2+p+i]   = COIN_DBL_MAX;
+      rlb [nPoints+2+p+N+i] = -COIN_DBL_MAX; rub [nPoints+2+p+N+i] = 0;
+    }
 
   for (int i=0; i<N; ++i) 
     isInt [i] = 1+N+i;
@@ -303,3 +312,69 @@ int populate (calInstance *instance, OsiSolverInterface *problem) {
 
   return 0;
 }
+
+/*
+ * Benders master: theta (lower bound on ||delta||_2, which is
+ * recovered by calWeights) and the N binary s variables, with the
+ * cardinality constraint only. Calibration enters through the cuts
+ * of calBenders.
+ */
+
+int populateMaster (calInstance *instance, OsiSolverInterface *problem) {
+
+  int
+    N = instance -> N (),
+    n = instance -> n (),
+
+    nvars = 1 + N,
+
+    *mbeg  = (int    *) malloc ((1+nvars) * sizeof (int)),
+    *mind  = (int    *) malloc (N         * sizeof (int)),
+    *isInt = (int    *) malloc (N         * sizeof (int));
+
+  double
+    rlb   = n,
+    rub   = n,
+    *obj  = (double *) malloc (nvars * sizeof (double)),
+    *lb   = (double *) malloc (nvars * sizeof (double)),
+    *ub   = (double *) malloc (nvars * sizeof (double)),
+    *mval = (double *) malloc (N     * sizeof (double));
+
+  mbeg [0] = 0; // theta does not appear in any row
+  lb   [0] = 0;
+  ub   [0] = COIN_DBL_MAX;
+  obj  [0] = 1;
+
+  for (int i=0; i<N; ++i) {
+
+    mbeg  [1+i] = i;
+    mind  [i]   = 0;
+    mval  [i]   = 1;
+
+    lb    [1+i] = 0;
+    ub    [1+i] = 1;
+    obj   [1+i] = 0;
+
+    isInt [i]   = 1+i;
+  }
+
+  mbeg [nvars] = N;
+
+  problem -> loadProblem (nvars, 1, mbeg, mind, mval, lb, ub, obj, &rlb, &rub);
+  problem -> setInteger (isInt, N);
+
+#ifdef DEBUG
+  problem -> writeLp ("master");
+#endif
+
+  free (obj);
+  free (lb);
+  free (ub);
+
+  free (mbeg);
+  free (mval);
+  free (mind);
+  free (isInt);
+
+  return 0;
+}
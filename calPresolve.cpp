@@ -0,0 +1,169 @@
+/*
+ * optimal calibrated sampling -- presolve of the root MILP
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <math.h>
+
+#include <OsiSolverInterface.hpp>
+#include <CoinPackedMatrix.hpp>
+#include <CoinHelperFunctions.hpp>
+#include <CoinFinite.hpp>
+
+#include "calInstance.hpp"
+
+//#define DEBUG
+
+#define PRESOLVE_PASSES 5    // max # passes over the rows
+#define PRESOLVE_TOL    1e-7 // minimum (relative) change to record a tightened bound
+
+//
+// Presolve the root MILP once per instance, by interval propagation
+// on its cardinality, sum-of-deltas, calibration and linking rows
+// (the rows after the 2N cone rows, as in calBT), with rounding of
+// the s variables. Only primal reductions: a bound is tightened only
+// if every point satisfying these rows satisfies it. No dual or
+// objective-based fixing is done, as the LP objective is just z over
+// an outer approximation of the cone (the true objective ||delta|| is
+// enforced by calCut): such fixings could be invalid for the real
+// model, or drop samples that are as good as the others and bias the
+// sampling. The model keeps its z, delta, s layout, as the cut
+// generators, branching objects and checkSolution () expect. The root
+// LP is then solved so that every copy of the model (one for each BB
+// run in calModel::search and in CalCubeHeur) starts from its basis.
+//
+// These are the bounds that calBT finds at the root node without a
+// cutoff: presolving moves that work, and the LP resolve that follows
+// it, from the root of every BB run to once per root MILP, which batch
+// and daemon mode also keep across runs of the same instance. calBT at
+// the root of each copy then only has the cutoff to work with.
+//
+// Returns the number of bounds tightened, or -1 if propagation found
+// the problem infeasible (the model is left unchanged).
+//
+
+// Interval propagation on row r of m: lo <= sum_k a_k x_k <= up.
+// Returns false if infeasible
+
+static bool propagateRow (const CoinPackedMatrix *m, int r, double lo, double up,
+			  int N, double *lb, double *ub, bool &changed) {
+  const CoinBigIndex
+    beg = m -> getVectorStarts  () [r],
+    end = beg + m -> getVectorLengths () [r];
+
+  const int    *ind = m -> getIndices  ();
+  const double *val = m -> getElements ();
+
+  double
+    minAct = 0.,
+    maxAct = 0.;
+
+  for (CoinBigIndex k=beg; k<end; ++k) {
+
+    double
+      a = val [k],
+      l = lb [ind [k]],
+      u = ub [ind [k]];
+
+    if ((l < -1e20) || (u > 1e20)) // only propagate rows with bounded variables
+      return true;
+
+    if (a > 0.) {minAct += a * l; maxAct += a * u;}
+    else        {minAct += a * u; maxAct += a * l;}
+  }
+
+  double tol = PRESOLVE_TOL * (1. + CoinMax (fabs (minAct), fabs (maxAct)));
+
+  if (((up <  1e20) && (minAct > up + tol)) ||
+      ((lo > -1e20) && (maxAct < lo - tol)))
+    return false;
+
+  for (CoinBigIndex k=beg; k<end; ++k) {
+
+    int    j = ind [k];
+    double a = val [k],
+      l = lb [j],
+      u = ub [j],
+      newLb = -COIN_DBL_MAX,
+      newUb =  COIN_DBL_MAX;
+
+    if (a > 0.) {
+      if (up <  1e20) newUb = l + (up - minAct) / a;
+      if (lo > -1e20) newLb = u + (lo - maxAct) / a;
+    } else {
+      if (up <  1e20) newLb = u + (up - minAct) / a;
+      if (lo > -1e20) newUb = l + (lo - maxAct) / a;
+    }
+
+    if (j > N) { // s variables are binary
+      newLb = ceil  (newLb - 1e-6);
+      newUb = floor (newUb + 1e-6);
+    }
+
+    if (newLb > l + PRESOLVE_TOL * (1. + fabs (l))) {lb [j] = newLb; changed = true;}
+    if (newUb < u - PRESOLVE_TOL * (1. + fabs (u))) {ub [j] = newUb; changed = true;}
+
+    if (lb [j] > ub [j] + PRESOLVE_TOL * (1. + fabs (ub [j])))
+      return false;
+  }
+
+  return true;
+}
+
+int presolve (calInstance *instance, OsiSolverInterface *problem) {
+
+  int
+    N      = instance -> N (),
+    nCols  = 1 + 2*N,
+    nTight = 0;
+
+  const CoinPackedMatrix *m = problem -> getMatrixByRow ();
+
+  const double
+    *rowLo = problem -> getRowLower (),
+    *rowUp = problem -> getRowUpper ();
+
+  double
+    *lb = CoinCopyOfArray (problem -> getColLower (), nCols),
+    *ub = CoinCopyOfArray (problem -> getColUpper (), nCols);
+
+  bool changed = true;
+
+  for (int pass = 0; changed && (pass < PRESOLVE_PASSES); ++pass) {
+
+    changed = false;
+
+    for (int r = 2*N; r < problem -> getNumRows (); ++r)
+      if (!propagateRow (m, r, rowLo [r], rowUp [r], N, lb, ub, changed)) {
+	delete [] lb;
+	delete [] ub;
+	return -1;
+      }
+  }
+
+  const double
+    *oldLb = problem -> getColLower (),
+    *oldUb = problem -> getColUpper ();
+
+  for (int j=1; j<nCols; ++j) {
+
+#ifdef DEBUG
+    if ((lb [j] != oldLb [j]) || (ub [j] != oldUb [j]))
+      printf ("presolve: col %d [%g,%g] -> [%g,%g]\n", j, oldLb [j], oldUb [j], lb [j], ub [j]);
+#endif
+
+    if (lb [j] != oldLb [j]) {problem -> setColLower (j, lb [j]); ++nTight;}
+    if (ub [j] != oldUb [j]) {problem -> setColUpper (j, ub [j]); ++nTight;}
+  }
+
+  delete [] lb;
+  delete [] ub;
+
+  // solve the root LP once; its basis is copied along with the model
+
+  problem -> initialSolve ();
+
+  return nTight;
+}
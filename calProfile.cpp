@@ -0,0 +1,158 @@
+/*
+ * optimal calibrated sampling -- profiling counters
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdio.h>
+
+#include "calProfile.hpp"
+
+// names of the phases in the report, in the order of calPhase
+
+static const char *phaseName [PROF_NPHASES] = {
+  "project",
+  "dgelqf",
+  "dorglq",
+  "dgesvd",
+  "project-vectors",
+  "flight",
+  "changeLU",
+  "bb",
+  "cube-bb",
+  "cube-light",
+  "calCut",
+  "calBT"
+};
+
+void calProfile::counters::clear () {
+
+  for (int i=0; i<PROF_NPHASES; ++i) {
+    calls   [i] = 0;
+    seconds [i] = 0.;
+    count   [i] = 0;
+
+    for (int j=0; j<PERF_NCOUNTERS; ++j)
+      hw [i] [j] = 0;
+  }
+}
+
+calProfile::calProfile ():
+
+  start_   (calWallTime ()),
+  lastEnd_ (start_),
+  repl_    (NULL),
+  nRepl_   (0),
+  maxRepl_ (0) {
+
+  total_. clear ();
+  last_.  clear ();
+}
+
+calProfile::~calProfile ()
+{delete [] repl_;}
+
+void calProfile::endReplication (int repl, bool sample) {
+
+  if (nRepl_ == maxRepl_) {
+
+    maxRepl_ = maxRepl_ ? 2 * maxRepl_ : 16;
+
+    replication *more = new replication [maxRepl_];
+
+    for (int k=0; k<nRepl_; ++k)
+      more [k] = repl_ [k];
+
+    delete [] repl_;
+    repl_ = more;
+  }
+
+  replication &r = repl_ [nRepl_++];
+
+  double now = calWallTime ();
+
+  r. index   = repl;
+  r. sample  = sample;
+  r. seconds = now - lastEnd_;
+
+  for (int i=0; i<PROF_NPHASES; ++i) {
+    r. phases. calls   [i] = total_. calls   [i] - last_. calls   [i];
+    r. phases. seconds [i] = total_. seconds [i] - last_. seconds [i];
+    r. phases. count   [i] = total_. count   [i] - last_. count   [i];
+
+    for (int j=0; j<PERF_NCOUNTERS; ++j)
+      r. phases. hw [i] [j] = total_. hw [i] [j] - last_. hw [i] [j];
+  }
+
+  last_    = total_;
+  lastEnd_ = now;
+}
+
+// "phases": {"project": {"calls": 1, "seconds": 0.1, "count": 0}, ...},
+// with "cycles": 12345, ... if the hardware counters are on (null:
+// counter not available)
+
+static void writePhases (FILE *f, const calProfile::counters &c, const char *indent) {
+
+  long long avail [PERF_NCOUNTERS];
+
+  if (calPerfOn)
+    calPerfRead (avail);
+
+  fprintf (f, "%s\"phases\": {\n", indent);
+
+  for (int i=0; i<PROF_NPHASES; ++i) {
+
+    fprintf (f, "%s  \"%s\": {\"calls\": %ld, \"seconds\": %.6f, \"count\": %ld",
+	     indent, phaseName [i], c. calls [i], c. seconds [i], c. count [i]);
+
+    if (calPerfOn)
+      for (int j=0; j<PERF_NCOUNTERS; ++j) {
+	if (avail [j] < 0) fprintf (f, ", \"%s\": null", calPerfName [j]);
+	else               fprintf (f, ", \"%s\": %lld", calPerfName [j], c. hw [i] [j]);
+      }
+
+    fprintf (f, "}%s\n", (i < PROF_NPHASES - 1) ? "," : "");
+  }
+
+  fprintf (f, "%s}", indent);
+}
+
+bool calProfile::write (const char *filename, const char *name, int N, int n, int p) {
+
+  FILE *f = fopen (filename, "w");
+
+  if (!f)
+    return false;
+
+  fprintf (f, "{\n  \"instance\": \"");
+
+  for (const char *c = name; *c; ++c) { // file names: only quotes and backslashes to escape
+    if ((*c == '"') || (*c == '\\'))
+      fputc ('\\', f);
+    fputc (*c, f);
+  }
+
+  fprintf (f, "\",\n  \"N\": %d,\n  \"n\": %d,\n  \"p\": %d,\n", N, n, p);
+  fprintf (f, "  \"seconds\": %.6f,\n", calWallTime () - start_);
+  fprintf (f, "  \"replications\": [");
+
+  for (int k=0; k < nRepl_; ++k) {
+
+    fprintf (f, "%s\n    {\n      \"replication\": %d,\n      \"sample\": %s,\n      \"seconds\": %.6f,\n",
+	     k ? "," : "", 1 + repl_ [k]. index, repl_ [k]. sample ? "true" : "false", repl_ [k]. seconds);
+
+    writePhases (f, repl_ [k]. phases, "      ");
+    fprintf (f, "\n    }");
+  }
+
+  fprintf (f, "%s],\n  \"total\": {\n", nRepl_ ? "\n  " : "");
+
+  writePhases (f, total_, "    ");
+  fprintf (f, "\n  }\n}\n");
+
+  fclose (f);
+
+  return true;
+}
@@ -0,0 +1,151 @@
+/*
+ * optimal calibrated sampling -- profiling counters
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calProfile_hpp
+#define calProfile_hpp
+
+#include <stdlib.h>
+
+#include "calClock.hpp"
+#include "calPerf.hpp"
+
+//
+// Per-instance counters of the hot paths (option -J): for each phase
+// below, number of calls, wall-clock seconds, and a phase-specific
+// count. Times are inclusive: the projections of the flight phases
+// run by the Cube heuristic within a BB are counted both in
+// "project" and in "bb". At the end of each replication the counters
+// accumulated since the previous one are recorded, and calSolve ()
+// writes them, with the totals of the run, as a JSON report.
+//
+// With -H, each phase also has the hardware counters (calPerf.hpp) of
+// the thread that ran it, inclusive as the times are.
+//
+// A calProfile belongs to one instance, which is solved by one thread
+// at a time, hence no locking. When -J is not given the instance has
+// no calProfile and each timer costs a test on a NULL pointer.
+//
+
+enum calPhase {
+
+  PROF_PROJECT,    ///< CalCubeHeur::project (), all of it; count: iterations, if iterative (-I)
+  PROF_LQ,         ///< ... LQ decomposition (dgelqf)
+  PROF_ORGLQ,      ///< ... Q from the LQ reflectors (dorglq)
+  PROF_SVD,        ///< ... SVD of L (dgesvd, both calls)
+  PROF_VECTOR,     ///< ... filling A, and computing u from v (two calls per projection)
+  PROF_FLIGHT,     ///< flight phase (CalCubeHeur::standalone); count: iterations
+  PROF_CHANGELU,   ///< calModel::changeLU (); count: s variables fixed
+  PROF_BB,         ///< BB run of a replication; count: nodes
+  PROF_CUBE_BB,    ///< nested BB of the Cube heuristic; count: solutions found
+  PROF_CUBE_LIGHT, ///< light Cube heuristic (-l); count: solutions found
+  PROF_CUT,        ///< calCut::generateCuts (); count: cuts
+  PROF_BT,         ///< calBT::generateCuts (); count: cuts
+  PROF_NPHASES
+};
+
+class calProfile {
+
+public:
+
+  struct counters {
+
+    long   calls   [PROF_NPHASES];
+    double seconds [PROF_NPHASES];
+    long   count   [PROF_NPHASES];
+
+    long long hw [PROF_NPHASES] [PERF_NCOUNTERS]; ///< hardware counters (-H)
+
+    void clear ();
+  };
+
+protected:
+
+  struct replication {
+
+    int      index;
+    bool     sample;
+    double   seconds;
+    counters phases;
+  };
+
+  counters total_;  ///< since the start of the run
+  counters last_;   ///< total_ at the end of the previous replication
+  double   start_;  ///< calWallTime () at creation
+  double   lastEnd_;
+
+  replication *repl_;   ///< one record per replication ended
+  int          nRepl_;
+  int          maxRepl_;
+
+public:
+
+  calProfile ();
+  ~calProfile ();
+
+  /// add a call of phase, and its hardware counters if not NULL
+  void add   (enum calPhase phase, double seconds, const long long *hw = NULL) {
+
+    ++ total_. calls [phase]; total_. seconds [phase] += seconds;
+
+    if (hw)
+      for (int i=0; i<PERF_NCOUNTERS; ++i)
+	if (hw [i] > 0)
+	  total_. hw [phase] [i] += hw [i];
+  }
+
+  void count (enum calPhase phase, long k)
+  {total_. count [phase] += k;}
+
+  /// record the counters of replication repl (from 0), which found a
+  /// sample or not
+  void endReplication (int repl, bool sample);
+
+  /// write the JSON report of instance name (N, n, p) to filename.
+  /// Returns false if it cannot be opened
+  bool write (const char *filename, const char *name, int N, int n, int p);
+};
+
+//
+// Adds the time from its creation to its destruction, or to stop (),
+// to a phase of profile, if not NULL
+//
+
+class calProfTimer {
+
+protected:
+
+  calProfile    *profile_;
+  enum calPhase  phase_;
+  double         start_;
+  calPerfMark    perf_;
+
+public:
+
+  calProfTimer (calProfile *profile, enum calPhase phase):
+    profile_ (profile),
+    phase_   (phase),
+    start_   (profile ? calWallTime () : 0.),
+    perf_    (profile != NULL) {}
+
+  ~calProfTimer () {stop ();}
+
+  void stop () {
+    if (profile_) {
+      long long hw [PERF_NCOUNTERS];
+      profile_ -> add (phase_, calWallTime () - start_, perf_. delta (hw) ? hw : NULL);
+      profile_ = NULL;
+    }
+  }
+
+  /// add k to the phase's count (before stop ())
+  void count (long k) {
+    if (profile_)
+      profile_ -> count (phase_, k);
+  }
+};
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * optimal calibrated sampling -- threads and bounded queues
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdlib.h>
+
+#include "calQueue.hpp"
+
+//
+// calThread
+//
+
+calThread::calThread (void (*run) (void *), void *arg):
+
+  run_     (run),
+  arg_     (arg),
+  started_ (false) {
+
+#ifdef _MSC_VER
+  thread_  = CreateThread (NULL, 0, body, this, 0, NULL);
+  started_ = (thread_ != NULL);
+#else
+  started_ = (0 == pthread_create (&thread_, NULL, body, this));
+#endif
+}
+
+#ifdef _MSC_VER
+DWORD WINAPI calThread::body (LPVOID t) {
+  ((calThread *) t) -> run_ (((calThread *) t) -> arg_);
+  return 0;
+}
+#else
+void *calThread::body (void *t) {
+  ((calThread *) t) -> run_ (((calThread *) t) -> arg_);
+  return NULL;
+}
+#endif
+
+void calThread::join () {
+
+  if (!started_)
+    return;
+
+#ifdef _MSC_VER
+  WaitForSingleObject (thread_, INFINITE);
+  CloseHandle         (thread_);
+#else
+  pthread_join (thread_, NULL);
+#endif
+}
+
+//
+// calQueue
+//
+
+calQueue::calQueue (int capacity):
+
+  items_    (new void * [capacity]),
+  capacity_ (capacity),
+  head_     (0),
+  size_     (0),
+  closed_   (false) {
+
+#ifdef _MSC_VER
+  InitializeCriticalSection   (&lock_);
+  InitializeConditionVariable (&changed_);
+#else
+  pthread_mutex_init (&lock_,    NULL);
+  pthread_cond_init  (&changed_, NULL);
+#endif
+}
+
+calQueue::~calQueue () {
+
+#ifdef _MSC_VER
+  DeleteCriticalSection (&lock_);
+#else
+  pthread_cond_destroy  (&changed_);
+  pthread_mutex_destroy (&lock_);
+#endif
+
+  delete [] items_;
+}
+
+#ifdef _MSC_VER
+void calQueue::lock   () {EnterCriticalSection      (&lock_);}
+void calQueue::unlock () {LeaveCriticalSection      (&lock_);}
+void calQueue::wait   () {SleepConditionVariableCS  (&changed_, &lock_, INFINITE);}
+void calQueue::signal () {WakeAllConditionVariable  (&changed_);}
+#else
+void calQueue::lock   () {pthread_mutex_lock     (&lock_);}
+void calQueue::unlock () {pthread_mutex_unlock   (&lock_);}
+void calQueue::wait   () {pthread_cond_wait      (&changed_, &lock_);}
+void calQueue::signal () {pthread_cond_broadcast (&changed_);}
+#endif
+
+void calQueue::push (void *item) {
+
+  lock ();
+
+  while (size_ == capacity_)
+    wait ();
+
+  items_ [(head_ + size_++) % capacity_] = item;
+
+  signal ();
+  unlock ();
+}
+
+void *calQueue::pop () {
+
+  lock ();
+
+  while (!size_ && !closed_)
+    wait ();
+
+  void *item = NULL;
+
+  if (size_) {
+
+    item  = items_ [head_];
+    head_ = (head_ + 1) % capacity_;
+    --size_;
+
+    signal ();
+  }
+
+  unlock ();
+
+  return item;
+}
+
+void calQueue::close () {
+
+  lock ();
+  closed_ = true;
+  signal ();
+  unlock ();
+}
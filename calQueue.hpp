@@ -0,0 +1,88 @@
+/*
+ * optimal calibrated sampling -- threads and bounded queues
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calQueue_hpp
+#define calQueue_hpp
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+//
+// Minimal portable thread (pthreads, or Win32 under _MSC_VER)
+//
+
+class calThread {
+
+protected:
+
+  void (*run_) (void *);
+  void  *arg_;
+  bool   started_;
+
+#ifdef _MSC_VER
+  HANDLE    thread_;
+  static DWORD WINAPI body (LPVOID t);
+#else
+  pthread_t thread_;
+  static void *body (void *t);
+#endif
+
+public:
+
+  /// start run (arg) in a new thread
+  calThread (void (*run) (void *), void *arg);
+
+  /// false if the thread could not be created: run () was not called
+  bool started () {return started_;}
+
+  /// wait for it to return (if started)
+  void join ();
+};
+
+//
+// Bounded blocking FIFO of pointers, to connect the stages of a
+// pipeline. push () waits while the queue is full, pop () while it is
+// empty; after close (), pop () returns NULL once the queue is empty.
+//
+
+class calQueue {
+
+protected:
+
+  void **items_;
+  int    capacity_;
+  int    head_;
+  int    size_;
+  bool   closed_;
+
+#ifdef _MSC_VER
+  CRITICAL_SECTION   lock_;
+  CONDITION_VARIABLE changed_;
+#else
+  pthread_mutex_t    lock_;
+  pthread_cond_t     changed_;
+#endif
+
+  void lock   ();
+  void unlock ();
+  void wait   ();
+  void signal ();
+
+public:
+
+  calQueue (int capacity);
+  ~calQueue ();
+
+  void  push  (void *item);
+  void *pop   ();
+  void  close (); ///< no more items will be pushed
+};
+
+#endif
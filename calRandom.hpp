@@ -0,0 +1,51 @@
+/*
+ * optimal calibrated sampling -- random number generator
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calRandom_hpp
+#define calRandom_hpp
+
+#include <math.h>
+
+//
+// The 48-bit linear congruential generator of drand48 (), x' = (a x
+// + c) mod 2^48, on a state passed explicitly as in erand48 (), which
+// is not available on all platforms. The state is three 16-bit words,
+// and products are split in 16-bit words to fit in 32-bit arithmetic.
+//
+
+/// same state as srand48 (seed)
+inline void calSeedRandom (unsigned short *state, int seed) {
+
+  state [0] = 0x330E;
+  state [1] = (unsigned short) ( seed        & 0xffff);
+  state [2] = (unsigned short) ((seed >> 16) & 0xffff);
+}
+
+/// uniform in [0,1), the same sequence as drand48 ()
+inline double calRandom (unsigned short *state) {
+
+  const unsigned long
+    a0 = 0xE66D, a1 = 0xDEEC, a2 = 0x5, c = 0xB,
+    x0 = state [0], x1 = state [1], x2 = state [2];
+
+  unsigned long
+    p0 = a0 * x0 + c,
+    t  = a0 * x1,
+    u  = a1 * x0,
+    p1 = (t & 0xffff) + (u & 0xffff) + (p0 >> 16),
+    p2 = (t >> 16) + (u >> 16) + (p1 >> 16) + a0 * x2 + a1 * x1 + a2 * x0; // only low 16 bits needed
+
+  state [0] = (unsigned short) (p0 & 0xffff);
+  state [1] = (unsigned short) (p1 & 0xffff);
+  state [2] = (unsigned short) (p2 & 0xffff);
+
+  return ldexp ((double) state [0], -48) +
+         ldexp ((double) state [1], -32) +
+         ldexp ((double) state [2], -16);
+}
+
+#endif
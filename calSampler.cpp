@@ -0,0 +1,166 @@
+/*
+ * optimal calibrated sampling -- library interface
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include <CoinHelperFunctions.hpp>
+#include <CoinFinite.hpp>
+
+#include "calSampler.hpp"
+#include "calInstance.hpp"
+#include "calOutput.hpp"
+#include "calClock.hpp"
+
+//
+// Build the model and run all replications (calSolve.cpp)
+//
+
+class OsiClpSolverInterface;
+
+int calSolve (calInstance *instance, calOutput *out, const OsiClpSolverInterface *root = NULL);
+
+//
+// Output that passes each sample to a calibri::Callback
+//
+
+class calCallbackOutput: public calOutput {
+
+protected:
+
+  calibri::Callback &callback_;
+
+  int    *units_;
+  double *weights_;
+
+public:
+
+  calCallbackOutput (calInstance *inst, calibri::Callback &callback):
+    calOutput (inst),
+    callback_ (callback),
+    units_    (new int    [inst -> N ()]),
+    weights_  (new double [inst -> N ()]) {}
+
+  ~calCallbackOutput () {
+    delete [] units_;
+    delete [] weights_;
+  }
+
+  void writeHeader () {}
+
+  void writeSample (int repl, double obj, const double *sol) {
+
+    int
+      N    = instance_ -> N (),
+      nSel = 0;
+
+    double w0 = (double) N / instance_ -> n ();
+
+    for (int i=0; i<N; ++i)
+      if (fabs (sol [1 + N + i]) > 1e-6) {
+	units_   [nSel]   = i;
+	weights_ [nSel++] = w0 + sol [1 + i];
+      }
+
+    callback_. sample (repl, obj, nSel, units_, weights_);
+  }
+};
+
+namespace calibri {
+
+  Options::Options ():
+
+    eps           (-1.),
+    nReplications (1),
+    seed          (-1),
+    maxTime       (-1.),
+    maxTotalTime  (-1.),
+    nSolves       (100),
+    maxBBnodes    (-1),
+    maxIterations (-1),
+    stallPValue   (.05),
+    poolSize      (0),
+    benders       (false),
+    lightCube     (false),
+    targetOnly    (false),
+    noPresolve    (false) {}
+
+  Sampler::Sampler (int N, int p, const double *x, const char * const *ids):
+
+    N_   (N),
+    p_   (p),
+    x_   (CoinCopyOfArray (x, N * p)),
+    ids_ (NULL) {
+
+    if (ids) {
+
+      ids_ = new char * [N_];
+
+      for (int i=0; i<N_; ++i)
+	if (ids [i]) {
+	  ids_ [i] = new char [1 + strlen (ids [i])];
+	  strcpy (ids_ [i], 1 + strlen (ids [i]), ids [i]);
+	} else ids_ [i] = NULL;
+    }
+  }
+
+  Sampler::~Sampler () {
+
+    if (ids_) {
+      for (int i=0; i<N_; ++i)
+	delete [] ids_ [i];
+      delete [] ids_;
+    }
+
+    delete [] x_;
+  }
+
+  int Sampler::run (int n, const Options &options, Callback &callback,
+		    const volatile bool *cancel) const {
+
+    if ((n < 1) || (n >= N_))
+      return -1;
+
+    if (options.nReplications < 1)
+      return 0;
+
+    // a new instance for each run: removeRedundantX () and presolve
+    // change it
+
+    calInstance *instance = new calInstance (N_, n, p_, x_, ids_);
+
+    if (options.eps  >= 0.) instance -> eps_      = options.eps;
+    if (options.seed >= 0)  instance -> randSeed_ = options.seed;
+
+    instance -> nRepl_      = options.nReplications;
+    instance -> maxTime_    = options.maxTime;
+    instance -> maxTotTime_ = options.maxTotalTime;
+    instance -> nSolves_    = options.nSolves;
+    instance -> maxBB_      = options.maxBBnodes;
+    instance -> maxIt_      = options.maxIterations;
+    instance -> stallPVal_  = options.stallPValue;
+    instance -> poolSize_   = options.poolSize;
+    instance -> benders_    = options.benders;
+    instance -> lightCube_  = options.lightCube;
+    instance -> targetOnly_ = options.targetOnly;
+    instance -> noPresolve_ = options.noPresolve;
+    instance -> quiet_      = true;
+
+    if (options.maxTotalTime >= 0.)
+      instance -> deadline_ = calWallTime () + options.maxTotalTime;
+
+    instance -> cancel_ = cancel;
+
+    calCallbackOutput out (instance, callback);
+
+    int nSamples = calSolve (instance, &out);
+
+    delete instance;
+
+    return nSamples;
+  }
+}
@@ -0,0 +1,90 @@
+/*
+ * optimal calibrated sampling -- library interface
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calSampler_hpp
+#define calSampler_hpp
+
+//
+// Calibri as a library. A Sampler holds a population (N units with p
+// calibration values each) and draws calibrated samples from it with
+// the same algorithm as the executable, passing each sample to a
+// Callback instead of writing a .sol file.
+//
+// No process-wide state is used: each call to run () builds its own
+// instance, model, random number generator, and deadline, so that
+// several calls (on the same Sampler or not) can run at the same time
+// from different threads. A run stops early when the cancellation
+// flag passed to it is set, at the next node of the current BB.
+//
+
+namespace calibri {
+
+  /// Options, with the same defaults as the command line (see calibri -h)
+
+  struct Options {
+
+    double eps;           ///< -e: a replication stops at a sample with ||w-d||^2 below this (negative: default)
+    int    nReplications; ///< -R
+    int    seed;          ///< -s (negative: from the current time)
+    double maxTime;       ///< -t: seconds for each BB run (negative: none)
+    double maxTotalTime;  ///< -T: seconds for the whole run (negative: none)
+    int    nSolves;       ///< -k: BB runs per replication
+    int    maxBBnodes;    ///< -b (negative: none)
+    int    maxIterations; ///< -i (negative: none)
+    double stallPValue;   ///< -K
+    int    poolSize;      ///< -Q
+    bool   benders;       ///< -D
+    bool   lightCube;     ///< -l
+    bool   targetOnly;    ///< -F
+    bool   noPresolve;    ///< -N
+
+    Options ();
+  };
+
+  /// Receives the samples of a run, in the thread that called run ()
+
+  class Callback {
+
+  public:
+
+    virtual ~Callback () {}
+
+    /// sample found by replication repl (from 0), of value obj =
+    /// ||w-d||^2: the n selected units, by increasing index (from 0),
+    /// and their weights
+    virtual void sample (int repl, double obj, int n, const int *units, const double *weights) = 0;
+  };
+
+  class Sampler {
+
+  protected:
+
+    int     N_;
+    int     p_;
+    double *x_;   ///< N_ rows of p_ values
+    char  **ids_; ///< unit names (NULL if none)
+
+  private:
+
+    Sampler (const Sampler &);             // not copied
+    Sampler &operator= (const Sampler &);
+
+  public:
+
+    /// population of N units: x has N rows of p calibration values,
+    /// ids (optional) the N unit names. Both are copied
+    Sampler (int N, int p, const double *x, const char * const *ids = NULL);
+    ~Sampler ();
+
+    /// draw samples of size n. Returns the number of samples passed to
+    /// callback, or -1 if n is not in [1,N-1]
+    int run (int n, const Options &options, Callback &callback,
+	     const volatile bool *cancel = NULL) const;
+  };
+}
+
+#endif
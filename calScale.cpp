@@ -0,0 +1,387 @@
+/*
+ * optimal calibrated sampling -- end-to-end scaling benchmark
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#include <psapi.h>
+#pragma comment (lib, "psapi.lib")
+#else
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#include <CoinFinite.hpp>
+#include <CoinHelperFunctions.hpp>
+
+#include "calInstance.hpp"
+#include "calOutput.hpp"
+#include "calClock.hpp"
+#include "calSynth.hpp"
+#include "cmdLine.hpp"
+
+//
+// calscale: solves random populations (see calSynth.hpp) of
+// increasing size with each algorithm type (options -r, -c, -g of
+// calibri), and writes one CSV line per run with
+//
+//   time_to_eps         seconds to the first sample below epsilon (-1: none)
+//   samples_per_second  samples found over the run's wall-clock time
+//   peak_rss_kb         peak resident memory of the process so far
+//
+// Runs are in increasing order of N, so that the peak memory is that
+// of the largest instance solved. The output of a run is a baseline
+// for the next ones: with -b, each line is compared with the line of
+// the baseline with the same algorithm, N, p and density, and runs
+// whose times or memory grew, or whose throughput dropped, by more
+// than the tolerance factor -x are reported, and the exit status is
+// 1. A run with no matching line in the baseline counts as one
+// regression. The baseline is read before the output is written, so
+// both can be the same file.
+//
+
+#define SCALE_MAX_LIST 64   // values in each list of option
+#define SCALE_MAX_LINE 1024 // longest baseline line
+
+#define SCALE_DENSITY_TOL 1e-5 // relative, as density is written with %g
+
+class OsiClpSolverInterface;
+
+int calSolve (calInstance *instance, calOutput *out, const OsiClpSolverInterface *root = NULL);
+
+static const char *algName [] = {"rand", "cube", "global"}; // as calInstance::AlgType
+
+// counts the samples, and records when the first below epsilon came
+
+class calScaleOutput: public calOutput {
+
+public:
+
+  int    nSamples;
+  double start;
+  double timeToEps;
+
+  calScaleOutput (calInstance *inst):
+    calOutput (inst),
+    nSamples  (0),
+    start     (calWallTime ()),
+    timeToEps (-1.) {}
+
+  void writeHeader () {}
+
+  void writeSample (int repl, double obj, const double *sol) {
+
+    ++nSamples;
+
+    if ((timeToEps < 0.) && (obj <= instance_ -> eps ()))
+      timeToEps = calWallTime () - start;
+  }
+};
+
+// peak resident memory of this process, in KB
+
+static long peakRSS () {
+
+#ifdef _MSC_VER
+
+  PROCESS_MEMORY_COUNTERS pmc;
+
+  if (!GetProcessMemoryInfo (GetCurrentProcess (), &pmc, sizeof (pmc)))
+    return -1;
+
+  return (long) (pmc.PeakWorkingSetSize / 1024);
+
+#else
+
+  struct rusage ru;
+
+  if (getrusage (RUSAGE_SELF, &ru))
+    return -1;
+
+#ifdef __APPLE__
+  return ru.ru_maxrss / 1024; // bytes
+#else
+  return ru.ru_maxrss;
+#endif
+
+#endif
+}
+
+// one result line, as written and as read from a baseline
+
+struct scaleResult {
+
+  char   alg [20];
+  int    N, n, p, nRepl, nSamples;
+  double density, seconds, timeToEps, samplesPerSec;
+  long   peakKB;
+};
+
+#define SCALE_HEADER "algorithm,N,n,p,density,replications,samples,seconds,time_to_eps,samples_per_second,peak_rss_kb"
+
+static void writeResult (FILE *f, const scaleResult &r) {
+
+  fprintf (f, "%s,%d,%d,%d,%g,%d,%d,%.6g,%.6g,%.6g,%ld\n",
+	   r.alg, r.N, r.n, r.p, r.density, r.nRepl, r.nSamples,
+	   r.seconds, r.timeToEps, r.samplesPerSec, r.peakKB);
+}
+
+static bool readResult (const char *line, scaleResult &r) {
+
+  return (sscanf (line, "%19[^,],%d,%d,%d,%lf,%d,%d,%lf,%lf,%lf,%ld",
+		  r.alg, &r.N, &r.n, &r.p, &r.density, &r.nRepl, &r.nSamples,
+		  &r.seconds, &r.timeToEps, &r.samplesPerSec, &r.peakKB) == 11);
+}
+
+// read all result lines of a baseline file into base (allocated
+// here); returns their number, or -1 if the file cannot be read
+
+static int readBaseline (const char *filename, scaleResult *&base) {
+
+  FILE *f = fopen (filename, "r");
+
+  base = NULL;
+
+  if (!f)
+    return -1;
+
+  char line [SCALE_MAX_LINE];
+
+  int nLines = 0;
+
+  while (fgets (line, SCALE_MAX_LINE, f))
+    ++nLines;
+
+  base = new scaleResult [nLines + 1];
+
+  rewind (f);
+
+  int nBase = 0;
+
+  while ((nBase < nLines) && fgets (line, SCALE_MAX_LINE, f))
+    if (readResult (line, base [nBase]))
+      ++nBase;
+
+  fclose (f);
+
+  return nBase;
+}
+
+// densities are read back from their %g output: equal to six digits
+
+static bool sameDensity (double a, double b) {
+  return fabs (a - b) <= SCALE_DENSITY_TOL * CoinMax (fabs (a), fabs (b));
+}
+
+// compare r with the matching line of the baseline; returns the
+// number of regressions found, one if r is not in the baseline
+
+static int compare (const scaleResult *base, int nBase, const scaleResult &r, double tol) {
+
+  for (int i=0; i<nBase; ++i) {
+
+    const scaleResult &b = base [i];
+
+    if (strcmp (b.alg, r.alg) || (b.N != r.N) || (b.p != r.p) || !sameDensity (b.density, r.density))
+      continue;
+
+    int nReg = 0;
+
+    if ((b.timeToEps >= 0.) && ((r.timeToEps < 0.) || (r.timeToEps > tol * b.timeToEps))) {
+      printf ("Regression: %s N=%d p=%d: time to epsilon %g, was %g\n", r.alg, r.N, r.p, r.timeToEps, b.timeToEps);
+      ++nReg;
+    }
+
+    if (r.samplesPerSec * tol < b.samplesPerSec) {
+      printf ("Regression: %s N=%d p=%d: %g samples/s, was %g\n", r.alg, r.N, r.p, r.samplesPerSec, b.samplesPerSec);
+      ++nReg;
+    }
+
+    if ((b.peakKB > 0) && (r.peakKB > tol * b.peakKB)) {
+      printf ("Regression: %s N=%d p=%d: peak RSS %ld KB, was %ld KB\n", r.alg, r.N, r.p, r.peakKB, b.peakKB);
+      ++nReg;
+    }
+
+    return nReg;
+  }
+
+  // nothing to compare with: not a pass
+
+  printf ("Missing: %s N=%d p=%d density=%g not in the baseline\n", r.alg, r.N, r.p, r.density);
+
+  return 1;
+}
+
+int main (int argc, char *argv []) {
+
+  calSynthSpec spec;
+
+  bool needHelp = false;
+
+  int nRepl = 10;
+
+  double
+    maxTime = 60.,
+    tol     = 1.25;
+
+  tpar options [] = {{ 'N', (char *) "sizes",            0, NULL,          ::TSTRING, (char *) "population sizes, comma-separated (default: 1000,10000,100000)"}
+		     ,{'a', (char *) "algorithms",       0, NULL,          ::TSTRING, (char *) "algorithm types: rand,cube,global (default: all)"}
+		     ,{'p', (char *) "calib",            4, &spec.p,       ::TINT,    (char *) "number of calibration vectors"}
+		     ,{'d', (char *) "density",          1, &spec.density, ::TDOUBLE, (char *) "probability that a calibration value is nonzero"}
+		     ,{'u', (char *) "duplicates",       0, &spec.dupRate, ::TDOUBLE, (char *) "probability that a unit duplicates a previous one"}
+		     ,{'s', (char *) "seed",             1, &spec.seed,    ::TINT,    (char *) "random seed of populations and solver"}
+		     ,{'R', (char *) "replications",    10, &nRepl,        ::TINT,    (char *) "replications of each run (one with \"global\")"}
+		     ,{'T', (char *) "tot-time",        60, &maxTime,      ::TDOUBLE, (char *) "seconds for each run"}
+		     ,{'o', (char *) "output",           0, NULL,          ::TSTRING, (char *) "results file (default: calscale.csv)"}
+		     ,{'b', (char *) "baseline",         0, NULL,          ::TSTRING, (char *) "compare with the results in this file"}
+		     ,{'x', (char *) "tolerance",     1.25, &tol,          ::TDOUBLE, (char *) "factor beyond which a difference from the baseline is a regression"}
+		     ,{'h', (char *) "help",             0, &needHelp,     ::TTOGGLE, (char *) "print this help"}
+		     ,{0,   (char *) "",                 0, NULL,          ::TTOGGLE, (char *) ""} /* THIS ENTRY ALWAYS AT THE END */
+  };
+
+  set_default_args (options);
+
+  char
+    *sizes    = NULL,
+    *algs     = NULL,
+    *output   = NULL,
+    *baseline = NULL;
+
+  options [0].par = &sizes; // after set_default_args, as they are NULL
+  options [1].par = &algs;
+  options [8].par = &output;
+  options [9].par = &baseline;
+
+  char **filenames = readargs (argc, argv, options);
+
+  if (filenames) {
+    for (int i=0; filenames [i]; ++i)
+      free (filenames [i]);
+    free (filenames);
+  }
+
+  if (needHelp) {
+    printf ("%s -- end-to-end scaling benchmark of calibri on random populations\n\n", argv [0]);
+    print_help (argv [0], options);
+    return 0;
+  }
+
+  double sizeList [SCALE_MAX_LIST];
+
+  int nSizes = read_list (sizes, sizeList, SCALE_MAX_LIST);
+
+  if (!nSizes) {
+    sizeList [0] = 1000; sizeList [1] = 10000; sizeList [2] = 100000;
+    nSizes = 3;
+  }
+
+  // increasing N: see peak RSS above
+
+  for   (int i=0; i<nSizes; ++i)
+    for (int j=i+1; j<nSizes; ++j)
+      if (sizeList [j] < sizeList [i]) {
+	double t = sizeList [i]; sizeList [i] = sizeList [j]; sizeList [j] = t;
+      }
+
+  // read the whole baseline before opening the output, which may be
+  // the same file (as with "calscale -b calscale.csv")
+
+  scaleResult *base = NULL;
+
+  int nBase = baseline ? readBaseline (baseline, base) : 0;
+
+  if (nBase < 0) {printf ("Error: cannot read baseline %s\n", baseline); return -1;}
+
+  if (baseline && !nBase)
+    printf ("Warning: no results in baseline %s\n", baseline);
+
+  FILE *f = fopen (output ? output : "calscale.csv", "w");
+
+  if (!f) {printf ("Error: cannot write %s\n", output ? output : "calscale.csv"); delete [] base; return -1;}
+
+  fprintf (f, "%s\n", SCALE_HEADER);
+
+  int nReg = 0;
+
+  for (int i=0; i<nSizes; ++i) {
+
+    spec.N = (int) sizeList [i];
+    spec.n = spec.N / 10;
+
+    if ((spec.N < 2) || (spec.n < 1))
+      continue;
+
+    double *x = calSynthX (spec);
+
+    if (!x) {
+      printf ("N = %d: population too large, skipped\n", spec.N);
+      continue;
+    }
+
+    for (int a = calInstance::RANDOM; a <= calInstance::GLOBAL; ++a) {
+
+      if (algs && !strstr (algs, algName [a]))
+	continue;
+
+      calInstance *instance = new calInstance (spec.N, spec.n, spec.p, x);
+
+      instance -> algType       () = (enum calInstance::AlgType) a;
+      instance -> nReplications () = (a == calInstance::GLOBAL) ? 1 : nRepl;
+      instance -> randSeed      () = spec.seed;
+      instance -> quiet         () = true;
+      instance -> deadline      () = calWallTime () + maxTime;
+
+      scaleResult r;
+
+      strcpy (r.alg, sizeof (r.alg), algName [a]);
+
+      r.N       = spec.N;
+      r.n       = spec.n;
+      r.p       = spec.p;
+      r.density = spec.density;
+      r.nRepl   = instance -> nReplications ();
+
+      calScaleOutput out (instance);
+
+      calSolve (instance, &out);
+
+      r.nSamples      = out.nSamples;
+      r.seconds       = calWallTime () - out.start;
+      r.timeToEps     = out.timeToEps;
+      r.samplesPerSec = (r.seconds > 0.) ? r.nSamples / r.seconds : 0.;
+      r.peakKB        = peakRSS ();
+
+      delete instance;
+
+      writeResult (f, r);
+      fflush (f);
+
+      if (baseline)
+	nReg += compare (base, nBase, r, tol);
+    }
+
+    delete [] x;
+  }
+
+  fclose (f);
+
+  if (baseline)
+    printf ("%d regression(s) with respect to %s\n", nReg, baseline);
+
+  delete [] base;
+
+  free (sizes);
+  free (algs);
+  free (output);
+  free (baseline);
+
+  return nReg ? 1 : 0;
+}
@@ -8,7 +8,13 @@
 #include "calModel.hpp"
 #include "calCube.hpp"
 #include "calInstance.hpp"
-#include "CoinTime.hpp"
+#include "calLNS.hpp"
+#include "calPool.hpp"
+#include "calClock.hpp"
+#include "calOutput.hpp"
+#include "calProfile.hpp"
+#include "calTrace.hpp"
+#include "calPerf.hpp"
 
 #ifdef _MSC_VER
 #define sprintf sprintf_s
@@ -25,114 +31,137 @@
 //
 // For t:1..K 
 //
-//   2a) select a one in s0 and set it to zero, 
-//   2b) open k(t) bound intervals and call BB
-//   2c) fix integer variables and call quadratic solver
-//   2d) save bound and solution if improved or if below threshold (1e-4)
+//   2a) fix the s variables at the best solution so far, except for
+//       a neighbourhood chosen by calLNS
+//   2b) call BB
+//   2c) save bound and solution if improved, adapt neighbourhood
+//   2d) stop if the replication's time share is over or if the
+//       search has stalled
+//
+// Stall test: each BB run started from an incumbent is taken as a
+// Bernoulli trial that improves it with probability q, estimated as
+// (1 + #improving) / (2 + #runs) on the runs before the current
+// streak of k non-improving ones. Stop if (1-q)^k falls below the
+// p-value set with "-K". Time not used by a replication is shared
+// among the remaining ones.
+//
+// Duplicates (option -u): with "reject", samples output by previous
+// replications are cut off by no-good rows and refused by
+// checkSolution; with "reuse", a BB run that lands on one ends the
+// replication, which outputs it with the weights already computed.
 //
 
-#define N_MOVES    100   // number of moves
-#define N_RESTART   20   // preferably divides N_MOVES; number of iterations before restart
-#define FRACTION     0.2 // maximum % of elements unfixed
-#define RANDOM_MOBILITY 1
-
+#define STALL_MIN_RETRIES 5 // never stop before this many BB runs
 inline double square (register double x)
 {return (x > 1e40) ? x : (x * x);}
 
-extern bool      GLOBAL_interrupt;
-extern CbcModel *GLOBAL_curBB;
-
 //#define DEBUG
 
-bool calModel::search (CalCubeHeur &calCube, FILE *f, int repl) {
+bool calModel::search (CalCubeHeur &calCube, calOutput *out, int repl) {
 
   int
     N = instance_ -> N (),
-    n = instance_ -> n (),
     n_iter = (calInstance::GLOBAL == instance_ -> algType ()) ? 1 : instance_ -> nSolves ();
 
   double
     *bestSol = new double [1 + 2*N],
      bestObj = COIN_DBL_MAX;
 
-  double *s0 = NULL;
+  calLNS lns (instance_);
+
+  calTraceSpan replSpan ("replication", "replication", 1 + repl);
+
+  // this replication's share of the remaining total time
+
+  double
+    replStart = calWallTime (),
+    replShare = calTimeSlice (instance_ -> deadline (), instance_ -> nReplications () - repl);
+
+  // a sample left in the pool by previous BB runs will do, and
+  // makes the loop below exit at once
+
+  if (pool_ && (pool_ -> draw (bestSol) < COIN_DBL_MAX)) {
+    bestObj = bestSol [0];
+    printf ("Sample taken from solution pool\n");
+  }
+
+  int
+    nTrials    = 0, // BB runs started with an incumbent
+    nImproving = 0, // ... that improved it
+    nStalled   = 0; // consecutive ones that did not
+
+  for (int nRetries = 0; !(instance_ -> interrupted ()) && (nRetries < n_iter) && (square (bestObj) > instance_ -> eps ()); ++nRetries) {
+
+    calTraceSpan retrySpan ((nRetries > 0) ? "LNS retry" : "BB run", "retry", nRetries);
+
+    double timeLeft = (replShare >= COIN_DBL_MAX) ? COIN_DBL_MAX : replShare - (calWallTime () - replStart);
+
+    if ((nRetries > 0) && (timeLeft <= 0.))
+      break;
 
-  for (int nRetries = 0; !GLOBAL_interrupt && (nRetries < n_iter) && (square (bestObj) > instance_ -> eps ()); ++nRetries) {
+    double bbTime = CoinMin (instance_ -> maxTime () < 0. ? COIN_DBL_MAX : instance_ -> maxTime (),
+			     CoinMax (0., timeLeft));
 
-    setMaximumSeconds
-      (CoinMin (instance_ ->  maxTime       () < 0. ? COIN_DBL_MAX : instance_ -> maxTime (),
-		instance_ ->  maxTotalTime  () < 0. ? COIN_DBL_MAX :
-		(instance_ -> maxTotalTime  () - CoinCpuTime ()) /
-		(instance_ -> nReplications () - repl)));
+    setMaximumSeconds (bbTime);
 
     calModel *b = clone ();
 
+    b -> deadline () = (bbTime >= COIN_DBL_MAX) ? COIN_DBL_MAX : calWallTime () + bbTime;
+
+    if (instance_ -> targetOnly ())
+      b -> setCutoff (sqrt (instance_ -> eps ()) + 1e-9);
+
     OsiSolverInterface *si = b -> solver ();
 
+    // start from the (presolved) root bounds
+
+    const double
+      *rootLb = solver () -> getColLower (),
+      *rootUb = solver () -> getColUpper ();
+
     for (int i=0; i<N; ++i) {
-      si -> setColLower (1 + N + i, 0.);
-      si -> setColUpper (1 + N + i, 1.);
+      si -> setColLower (instance_ -> sCol (i), rootLb [instance_ -> sCol (i)]);
+      si -> setColUpper (instance_ -> sCol (i), rootUb [instance_ -> sCol (i)]);
     }
 
     if (calInstance::GLOBAL == instance_ -> algType ()) {
 
       // do nothing: just run the BB
 
-    } else if (0 == nRetries) {
+    } else if ((0 == nRetries) || (bestObj >= 1e20)) {
 
       //
-      // First step: generate initial solution, either from input
-      // vector or through the Cube variant
+      // First step (or no solution yet): generate initial solution,
+      // either from input vector or through the Cube variant
       //
       // Generate initial point ON SUBSPACE. Does nothing if algtype
       // in {RANDOM, GLOBAL}
       //
 
-      s0 = calCube. generateInitS (*si); 
+      double *s0 = calCube. generateInitS (*si); 
 
       calCube. standalone (s0); // call Cube method
 
       b -> changeLU (*si, s0); // fixes some of the s variables after
                                // cube's flight phase
+      delete [] s0;
 
-    } else { // change LU bounds based on current solution
+    } else { // neighbourhood of best solution so far
 
-#ifdef DEBUG
-      printVec (s0, N, "s0");
-#endif
-      
-      const double
-	// reduce changes when random and solution available
-	fraction    = FRACTION * (((calInstance::RANDOM == instance_ -> algType ()) && (instance_ -> d () [0] >= 0.)) ? RANDOM_MOBILITY : 1.), 
-	multiplier  = fraction * (double) (N_RESTART - (nRetries % N_RESTART)) / N_RESTART,
-	threshold_0 = multiplier * (double) (N-n) / N, // free half 0-fixed at beginning
-	threshold_1 = multiplier * (double)    n  / N; // free half 1-fixed
-      //threshold_0 = CoinMax (1. / CoinMax (1., (double) (N-n)), multiplier * (double) (N-n) / N), // free half 0-fixed at beginning
-      //threshold_1 = CoinMax (1. / CoinMax (1., (double) n),     multiplier * (double)    n  / N); // free half 1-fixed
-
-      bool one_changed = false;
-
-      for (int nAttempts = 0; nAttempts < 20 && !one_changed; ++nAttempts)
-	for (int i=0; i<N; ++i)
-	  if      (s0 [i] <     1e-5) {if (drand48 () > threshold_0) si -> setColUpper (1 + N + i, 0.); else one_changed = true;}
-	  else if (s0 [i] > 1 - 1e-5) {if (drand48 () > threshold_1) si -> setColLower (1 + N + i, 1.); else one_changed = true;}
+      lns. freeUnits (*si, bestSol);
 
 #ifdef DEBUG
       char filename [40];
       sprintf (filename, "lp_%d_%d", repl, nRetries);
       si -> writeLp (filename);
 #endif
-
-      // int nChanges = CoinMax (1, n / nRetries); // <------------------ Number of changed variables
-      // for (int i=0; i<nChanges;) {
-      // 	int indChange = floor ((N - 1e-4) * drand48 ());
-      // 	printf ("trying %d [%g,%g], i=%d\n", indChange, lb [1 + N + indChange], ub [1 + N + indChange], i);
-      // 	if (ub [1 + N + indChange] <     1e-5) {si -> setColUpper (1 + N + indChange, 1.); ++i;}
-      // 	if (lb [1 + N + indChange] > 1 - 1e-5) {si -> setColLower (1 + N + indChange, 0.); ++i;}
-      // }
     }
 
-    GLOBAL_curBB = b;
+    if (seen_ && (calInstance::DUP_REJECT == instance_ -> dupPolicy ()))
+      seen_ -> addNoGoods (*si);
+
+    calProfTimer bbTimer (instance_ -> profile (), PROF_BB);
+    calPerfMark  bbPerf;
 
                              //    /|
                              //   / |--------+
@@ -140,9 +169,12 @@ bool calModel::search (CalCubeHeur &calCube, FILE *f, int repl) {
                              //   \ |--------+
                              //    \|
 
+    bbTimer. count (b -> getNodeCount ());
+    bbTimer. stop  ();
+
     //assert (fabs (b -> bestObj () - val [0]) < 1e-5);
 
-    printf ("BB iteration %4d done (%10.2fs). ", 1+nRetries, CoinCpuTime ());
+    printf ("BB iteration %4d done (%10.2fs)", 1+nRetries, calWallTime ()); bbPerf. print (); printf (". ");
 
     //optimal = b -> isProvenOptimal(); 
     //const double *val = b -> getColSolution();
@@ -153,97 +185,97 @@ bool calModel::search (CalCubeHeur &calCube, FILE *f, int repl) {
       printf ("Best solution: value %10.4f\n", square (b -> bestObj ()));
     else printf ("No solution found :-(\n");
 
-    if (b -> bestSol ()) {
+    double oldObj = bestObj;
 
-      if (b -> bestObj () < bestObj) {
+    if (b -> bestSol () && (b -> bestObj () < bestObj)) {
 
-	bestObj = b -> bestObj ();
-	CoinCopyN (b -> bestSol (), 2*N+1, bestSol);
-      }
+      bestObj = b -> bestObj ();
+      CoinCopyN (b -> bestSol (), 2*N+1, bestSol);
+    }
 
-      if (!s0)
-	s0 = new double [N];
+    lns. update (oldObj, bestObj, b -> isProvenOptimal () || b -> isProvenInfeasible ());
 
-      CoinCopyN (b -> bestSol () + 1 + N, N, s0);
+    if (oldObj < 1e20) {
+
+      ++nTrials;
+
+      if (bestObj < oldObj) {++nImproving; nStalled = 0;}
+      else                              ++nStalled;
     }
 
     delete b;
-  }
 
-  bool 
-    retval = true,
-    row_format = (calInstance::ROW_BASED == instance_ -> outFormat ());
+    int seenPos;
 
-  delete [] s0;
+    if (seen_ && (calInstance::DUP_REUSE == instance_ -> dupPolicy ()) &&
+	(bestObj < 1e20) && ((seenPos = seen_ -> find (bestSol)) >= 0)) {
 
-  double w0 = (double) N / instance_ -> n ();
-
-  if (bestObj < 1e20) {
+      double *memo = new double [1 + 2*N];
 
-    const double *val = bestSol;
+      if (seen_ -> get (seenPos, memo) < bestObj) {
+	bestObj = memo [0];
+	CoinCopyN (memo, 1 + 2*N, bestSol);
+      }
 
-    if (row_format) 
-      fprintf (f, "%lf,", square (bestObj));
+      delete [] memo;
 
-    //double *d = instance_ -> d ();
+      printf ("Sample already output by a previous replication, reused\n");
+      break;
+    }
 
-    printf ("sample:\n");
+    double q = (1. + nImproving) / (2. + nTrials - nStalled);
 
-    for (int j=N+1, np=0; j<=2*N; ++j) {
+    if ((instance_ -> stallPValue () > 0.) &&
+	(nRetries + 1 >= STALL_MIN_RETRIES) &&
+	(pow (1. - q, nStalled) < instance_ -> stallPValue ())) {
 
-      char strNum [5];
+      printf ("Search stalled after %d BB runs (%d improving)\n", 1 + nRetries, nImproving);
+      break;
+    }
+  }
 
-      sprintf (strNum, "%d", j-N);
+  bool retval = (bestObj < 1e20);
 
-      if (!row_format) 
+  if (calInstance::GLOBAL != instance_ -> algType ())
+    lns. print ();
 
-	fprintf (f, "%d,%g,%s,%d,%g,\n",
-		 1+repl,
-		 square (bestObj),
-		 instance_ -> id (j-N-1) ? instance_ -> id (j-N-1) : strNum,
-		 (fabs (val [j]) > 1e-6) ? 1 : 0,
-		 w0 + val [j-N]);
+  if (pool_ && (bestObj < 1e20))
+    pool_ -> markUsed (bestSol); // don't give it to another replication
 
-      if (fabs (val [j]) > 1e-6) {
+  if (seen_ && (bestObj < 1e20))
+    seen_ -> offer (bestSol, bestObj);
 
-	if (row_format) 
-	  fprintf (f, "1,");
+  if (bestObj < 1e20) {
 
-	printf     ("%d ",  j-N);
-	if (!(++np % 10))
-	  printf ("\n");
-      } else 
-	if (row_format) 
-	  fprintf (f, "0,");
-    }
+    out -> writeSample (repl, square (bestObj), bestSol);
 
-    printf ("\nweights:\n");
+    if (!(instance_ -> quiet ())) {
 
-    for (int j=1, np=0; j<=N; ++j) {
+      double w0 = (double) N / instance_ -> n ();
 
-      if (row_format) 
-	fprintf (f, "%g,", w0 + val [j]);
+      printf ("sample:\n");
 
-      if (fabs (val [j]) > 1e-6) {
+      for (int j=N+1, np=0; j<=2*N; ++j)
+	if (fabs (bestSol [j]) > 1e-6) {
+	  printf ("%d ", j-N);
+	  if (!(++np % 10))
+	    printf ("\n");
+	}
 
-	printf    ("[%d,%g] ", j, w0 + val [j]);
-	if (!(++np % 10))
-	  printf ("\n");
-      }
-    }
+      printf ("\nweights:\n");
 
-    if (square (bestObj) > instance_ -> eps ()) {
+      for (int j=1, np=0; j<=N; ++j)
+	if (fabs (bestSol [j]) > 1e-6) {
+	  printf ("[%d,%g] ", j, w0 + bestSol [j]);
+	  if (!(++np % 10))
+	    printf ("\n");
+	}
 
-      printf ("(warning: solution has large objective at replication %d)", 1 + repl);
-      //retval = false;
+      printf ("\n");
     }
 
-    printf ("\n");
-
-    if (row_format) 
-      fprintf (f, "\n");
-
-    fflush (f);
+    if (square (bestObj) > instance_ -> eps ())
+      printf ("(warning: solution has large objective at replication %d)\n", 1 + repl);
   }
 
   delete [] bestSol;
@@ -0,0 +1,491 @@
+/*
+ * optimal calibrated sampling -- vector kernels with runtime dispatch
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "calSimd.hpp"
+
+// which instruction sets the compiler can generate, in functions
+// marked TARGET_AVX2 and TARGET_AVX512, regardless of its flags
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+#define SIMD_AVX2_OK
+#define SIMD_AVX512_OK
+#define TARGET_AVX2   __attribute__ ((target ("avx2")))
+
+#ifdef __clang__
+#define TARGET_AVX512 __attribute__ ((target ("avx512f")))
+#else // AVX-512 has FMA: keep the compiler from fusing
+#define TARGET_AVX512 __attribute__ ((target ("avx512f"), optimize ("fp-contract=off")))
+#endif
+
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+
+#include <intrin.h>
+#include <immintrin.h>
+
+#if _MSC_VER >= 1700 // Visual Studio 2012
+#define SIMD_AVX2_OK
+#endif
+
+#if _MSC_VER >= 1911 // Visual Studio 2017, 15.3
+#define SIMD_AVX512_OK
+#endif
+
+#define TARGET_AVX2
+#define TARGET_AVX512
+
+#endif
+
+#define SIMD_LANES 8 // partial sums of the reductions, at all levels
+
+const calSimdKernels *calSimdTable = NULL;
+
+// add up the partial sums as AVX2 and AVX-512 do: halves first
+
+static double combine (const double *s) {
+
+  double
+    t0 = s [0] + s [4],
+    t1 = s [1] + s [5],
+    t2 = s [2] + s [6],
+    t3 = s [3] + s [7];
+
+  return (t0 + t2) + (t1 + t3);
+}
+
+static double minOf (const double *s, int n, double m) {
+
+  for (int k=0; k<n; ++k)
+    m = (m < s [k]) ? m : s [k];
+
+  return m;
+}
+
+//
+// Scalar
+//
+
+static double sumSqScalar (const double *x, int n) {
+
+  double s [SIMD_LANES] = {0., 0., 0., 0., 0., 0., 0., 0.};
+
+  for (int i=0; i<n; ++i)
+    s [i & (SIMD_LANES - 1)] += x [i] * x [i];
+
+  return combine (s);
+}
+
+static void axpyScalar (double a, const double *x, double *y, int n) {
+
+  for (int i=0; i<n; ++i)
+    y [i] += a * x [i];
+}
+
+static void ratioTestScalar (const double *s, const double *u, int n, double tol, double *lambdaM, double *lambdaP) {
+
+  double
+    lM = *lambdaM,
+    lP = *lambdaP;
+
+  for (int i=0; i<n; ++i)
+
+    if (fabs (u [i]) > tol) {
+
+      double
+	cM = (u [i] > 0) ?      s [i]  / u [i] : (1 - s [i]) / u [i],
+	cP = (u [i] > 0) ? (1 - s [i]) / u [i] :    - s [i]  / u [i];
+
+      lM = (lM < cM) ? lM : cM;
+      lP = (lP < cP) ? lP : cP;
+    }
+
+  *lambdaM = lM;
+  *lambdaP = lP;
+}
+
+static double sparseDotScalar (const double *el, const int *ind, int nnz, const double *v) {
+
+  double s [SIMD_LANES] = {0., 0., 0., 0., 0., 0., 0., 0.};
+
+  for (int j=0; j<nnz; ++j)
+    s [j & (SIMD_LANES - 1)] += el [j] * v [ind [j]];
+
+  return combine (s);
+}
+
+static void subGemvScalar (const double *Q, int k, int n, const double *w, const double *v, double *u) {
+
+  for (int i=0; i<n; ++i) {
+
+    double ucurr = v [i];
+
+    for (int j=0; j<k; ++j)
+      ucurr -= Q [i*k + j] * w [j];
+
+    u [i] = ucurr;
+  }
+}
+
+static const calSimdKernels scalarKernels = {
+  SIMD_SCALAR, "scalar",
+  sumSqScalar, axpyScalar, ratioTestScalar, sparseDotScalar, subGemvScalar
+};
+
+//
+// AVX2: two vectors of four partial sums
+//
+
+#ifdef SIMD_AVX2_OK
+
+TARGET_AVX2 static double sumSqAvx2 (const double *x, int n) {
+
+  __m256d
+    a = _mm256_setzero_pd (),
+    b = _mm256_setzero_pd ();
+
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+
+    __m256d
+      xa = _mm256_loadu_pd (x + i),
+      xb = _mm256_loadu_pd (x + i + 4);
+
+    a = _mm256_add_pd (a, _mm256_mul_pd (xa, xa));
+    b = _mm256_add_pd (b, _mm256_mul_pd (xb, xb));
+  }
+
+  double s [SIMD_LANES];
+
+  _mm256_storeu_pd (s,     a);
+  _mm256_storeu_pd (s + 4, b);
+
+  for (; i<n; ++i)
+    s [i & (SIMD_LANES - 1)] += x [i] * x [i];
+
+  return combine (s);
+}
+
+TARGET_AVX2 static void axpyAvx2 (double a, const double *x, double *y, int n) {
+
+  __m256d va = _mm256_set1_pd (a);
+
+  int i = 0;
+
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd (y + i, _mm256_add_pd (_mm256_loadu_pd (y + i), _mm256_mul_pd (va, _mm256_loadu_pd (x + i))));
+
+  for (; i<n; ++i)
+    y [i] += a * x [i];
+}
+
+TARGET_AVX2 static void ratioTestAvx2 (const double *s, const double *u, int n, double tol, double *lambdaM, double *lambdaP) {
+
+  __m256d
+    vtol  = _mm256_set1_pd (tol),
+    one   = _mm256_set1_pd (1.),
+    mOne  = _mm256_set1_pd (-1.),
+    sign  = _mm256_set1_pd (-0.),
+    zero  = _mm256_setzero_pd (),
+    lM    = _mm256_set1_pd (*lambdaM),
+    lP    = _mm256_set1_pd (*lambdaP);
+
+  int i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+
+    __m256d
+      uu     = _mm256_loadu_pd (u + i),
+      ss     = _mm256_loadu_pd (s + i),
+      active = _mm256_cmp_pd (_mm256_andnot_pd (sign, uu), vtol, _CMP_GT_OQ),
+      pos    = _mm256_cmp_pd (uu, zero, _CMP_GT_OQ),
+      oneMs  = _mm256_sub_pd (one, ss),
+      cM     = _mm256_div_pd (_mm256_blendv_pd (oneMs,                    ss,    pos), uu),
+      cP     = _mm256_div_pd (_mm256_blendv_pd (_mm256_mul_pd (mOne, ss), oneMs, pos), uu);
+
+    lM = _mm256_blendv_pd (lM, _mm256_min_pd (lM, cM), active);
+    lP = _mm256_blendv_pd (lP, _mm256_min_pd (lP, cP), active);
+  }
+
+  double m [4], p [4];
+
+  _mm256_storeu_pd (m, lM);
+  _mm256_storeu_pd (p, lP);
+
+  *lambdaM = minOf (m, 4, *lambdaM);
+  *lambdaP = minOf (p, 4, *lambdaP);
+
+  ratioTestScalar (s + i, u + i, n - i, tol, lambdaM, lambdaP);
+}
+
+TARGET_AVX2 static double sparseDotAvx2 (const double *el, const int *ind, int nnz, const double *v) {
+
+  __m256d
+    a = _mm256_setzero_pd (),
+    b = _mm256_setzero_pd ();
+
+  int j = 0;
+
+  for (; j + 8 <= nnz; j += 8) {
+
+    __m256d
+      va = _mm256_i32gather_pd (v, _mm_loadu_si128 ((const __m128i *) (ind + j)),     8),
+      vb = _mm256_i32gather_pd (v, _mm_loadu_si128 ((const __m128i *) (ind + j + 4)), 8);
+
+    a = _mm256_add_pd (a, _mm256_mul_pd (_mm256_loadu_pd (el + j),     va));
+    b = _mm256_add_pd (b, _mm256_mul_pd (_mm256_loadu_pd (el + j + 4), vb));
+  }
+
+  double s [SIMD_LANES];
+
+  _mm256_storeu_pd (s,     a);
+  _mm256_storeu_pd (s + 4, b);
+
+  for (; j<nnz; ++j)
+    s [j & (SIMD_LANES - 1)] += el [j] * v [ind [j]];
+
+  return combine (s);
+}
+
+TARGET_AVX2 static void subGemvAvx2 (const double *Q, int k, int n, const double *w, const double *v, double *u) {
+
+  __m128i stride = _mm_set_epi32 (3*k, 2*k, k, 0); // four columns of Q
+
+  int i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+
+    __m256d acc = _mm256_loadu_pd (v + i);
+
+    const double *q = Q + i*k;
+
+    for (int j=0; j<k; ++j)
+      acc = _mm256_sub_pd (acc, _mm256_mul_pd (_mm256_i32gather_pd (q + j, stride, 8), _mm256_set1_pd (w [j])));
+
+    _mm256_storeu_pd (u + i, acc);
+  }
+
+  subGemvScalar (Q + i*k, k, n - i, w, v + i, u + i);
+}
+
+static const calSimdKernels avx2Kernels = {
+  SIMD_AVX2, "avx2",
+  sumSqAvx2, axpyAvx2, ratioTestAvx2, sparseDotAvx2, subGemvAvx2
+};
+
+#endif
+
+//
+// AVX-512: one vector of eight partial sums
+//
+
+#ifdef SIMD_AVX512_OK
+
+TARGET_AVX512 static double sumSqAvx512 (const double *x, int n) {
+
+  __m512d a = _mm512_setzero_pd ();
+
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+
+    __m512d xa = _mm512_loadu_pd (x + i);
+
+    a = _mm512_add_pd (a, _mm512_mul_pd (xa, xa));
+  }
+
+  double s [SIMD_LANES];
+
+  _mm512_storeu_pd (s, a);
+
+  for (; i<n; ++i)
+    s [i & (SIMD_LANES - 1)] += x [i] * x [i];
+
+  return combine (s);
+}
+
+TARGET_AVX512 static void axpyAvx512 (double a, const double *x, double *y, int n) {
+
+  __m512d va = _mm512_set1_pd (a);
+
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8)
+    _mm512_storeu_pd (y + i, _mm512_add_pd (_mm512_loadu_pd (y + i), _mm512_mul_pd (va, _mm512_loadu_pd (x + i))));
+
+  for (; i<n; ++i)
+    y [i] += a * x [i];
+}
+
+TARGET_AVX512 static void ratioTestAvx512 (const double *s, const double *u, int n, double tol, double *lambdaM, double *lambdaP) {
+
+  __m512i absMask = _mm512_set1_epi64 (0x7fffffffffffffffLL);
+
+  __m512d
+    vtol = _mm512_set1_pd (tol),
+    one  = _mm512_set1_pd (1.),
+    mOne = _mm512_set1_pd (-1.),
+    zero = _mm512_setzero_pd (),
+    lM   = _mm512_set1_pd (*lambdaM),
+    lP   = _mm512_set1_pd (*lambdaP);
+
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+
+    __m512d
+      uu    = _mm512_loadu_pd (u + i),
+      ss    = _mm512_loadu_pd (s + i),
+      absU  = _mm512_castsi512_pd (_mm512_and_si512 (_mm512_castpd_si512 (uu), absMask)),
+      oneMs = _mm512_sub_pd (one, ss);
+
+    __mmask8
+      active = _mm512_cmp_pd_mask (absU, vtol, _CMP_GT_OQ),
+      pos    = _mm512_cmp_pd_mask (uu,   zero, _CMP_GT_OQ);
+
+    __m512d
+      cM = _mm512_div_pd (_mm512_mask_blend_pd (pos, oneMs,                    ss),    uu),
+      cP = _mm512_div_pd (_mm512_mask_blend_pd (pos, _mm512_mul_pd (mOne, ss), oneMs), uu);
+
+    lM = _mm512_mask_min_pd (lM, active, lM, cM);
+    lP = _mm512_mask_min_pd (lP, active, lP, cP);
+  }
+
+  double m [8], p [8];
+
+  _mm512_storeu_pd (m, lM);
+  _mm512_storeu_pd (p, lP);
+
+  *lambdaM = minOf (m, 8, *lambdaM);
+  *lambdaP = minOf (p, 8, *lambdaP);
+
+  ratioTestScalar (s + i, u + i, n - i, tol, lambdaM, lambdaP);
+}
+
+TARGET_AVX512 static double sparseDotAvx512 (const double *el, const int *ind, int nnz, const double *v) {
+
+  __m512d a = _mm512_setzero_pd ();
+
+  int j = 0;
+
+  for (; j + 8 <= nnz; j += 8) {
+
+    __m512d vv = _mm512_i32gather_pd (_mm256_loadu_si256 ((const __m256i *) (ind + j)), v, 8);
+
+    a = _mm512_add_pd (a, _mm512_mul_pd (_mm512_loadu_pd (el + j), vv));
+  }
+
+  double s [SIMD_LANES];
+
+  _mm512_storeu_pd (s, a);
+
+  for (; j<nnz; ++j)
+    s [j & (SIMD_LANES - 1)] += el [j] * v [ind [j]];
+
+  return combine (s);
+}
+
+TARGET_AVX512 static void subGemvAvx512 (const double *Q, int k, int n, const double *w, const double *v, double *u) {
+
+  __m256i stride = _mm256_set_epi32 (7*k, 6*k, 5*k, 4*k, 3*k, 2*k, k, 0); // eight columns of Q
+
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+
+    __m512d acc = _mm512_loadu_pd (v + i);
+
+    const double *q = Q + i*k;
+
+    for (int j=0; j<k; ++j)
+      acc = _mm512_sub_pd (acc, _mm512_mul_pd (_mm512_i32gather_pd (stride, q + j, 8), _mm512_set1_pd (w [j])));
+
+    _mm512_storeu_pd (u + i, acc);
+  }
+
+  subGemvScalar (Q + i*k, k, n - i, w, v + i, u + i);
+}
+
+static const calSimdKernels avx512Kernels = {
+  SIMD_AVX512, "avx512",
+  sumSqAvx512, axpyAvx512, ratioTestAvx512, sparseDotAvx512, subGemvAvx512
+};
+
+#endif
+
+// widest level of this CPU (and operating system, which must save the
+// wider registers)
+
+static enum calSimdLevel cpuLevel () {
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("avx512f")) return SIMD_AVX512;
+  if (__builtin_cpu_supports ("avx2"))    return SIMD_AVX2;
+
+#elif defined(SIMD_AVX2_OK)
+
+  int r [4];
+
+  __cpuid (r, 0);
+
+  int nIds = r [0];
+
+  __cpuid (r, 1);
+
+  if ((nIds < 7) || !(r [2] & (1 << 27)) || !(r [2] & (1 << 28))) // OSXSAVE, AVX
+    return SIMD_SCALAR;
+
+  unsigned long long xcr0 = _xgetbv (0);
+
+  if ((xcr0 & 0x6) != 0x6) // XMM and YMM state
+    return SIMD_SCALAR;
+
+  __cpuidex (r, 7, 0);
+
+  if ((r [1] & (1 << 16)) && ((xcr0 & 0xe6) == 0xe6)) return SIMD_AVX512; // and ZMM state
+  if  (r [1] & (1 <<  5))                             return SIMD_AVX2;
+
+#endif
+
+  return SIMD_SCALAR;
+}
+
+const calSimdKernels *calSimdInit () {
+
+  enum calSimdLevel level = cpuLevel ();
+
+  const char *cap = getenv ("CALIBRI_SIMD");
+
+  if (cap) {
+    if      (!strcmp (cap, "scalar")) level = SIMD_SCALAR;
+    else if (!strcmp (cap, "avx2") && (level > SIMD_AVX2)) level = SIMD_AVX2;
+  }
+
+  const calSimdKernels *table = &scalarKernels;
+
+#ifdef SIMD_AVX2_OK
+  if (level >= SIMD_AVX2)   table = &avx2Kernels;
+#endif
+
+#ifdef SIMD_AVX512_OK
+  if (level >= SIMD_AVX512) table = &avx512Kernels;
+#endif
+
+  calSimdTable = table; // the same in all threads: no lock needed
+
+  return table;
+}
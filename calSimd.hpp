@@ -0,0 +1,57 @@
+/*
+ * optimal calibrated sampling -- vector kernels with runtime dispatch
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calSimd_hpp
+#define calSimd_hpp
+
+//
+// Loops over N doubles of the cuts, of the check of solutions, of the
+// flight phase and of the projection, as a table of functions
+// implemented in scalar code, AVX2, and AVX-512. The table is chosen
+// at the first call of calSimd (), as the widest the CPU and the
+// compiler support; environment variable CALIBRI_SIMD set to "scalar"
+// or "avx2" caps it, to compare them.
+//
+// All versions return the same results: reductions add element i to
+// partial sum i mod 8, and add up the partial sums in the same order,
+// and no multiply-add is fused.
+//
+
+enum calSimdLevel {SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512};
+
+struct calSimdKernels {
+
+  enum calSimdLevel level;
+  const char       *name;
+
+  /// sum of x_i^2
+  double (*sumSq)     (const double *x, int n);
+
+  /// y += a * x
+  void   (*axpy)      (double a, const double *x, double *y, int n);
+
+  /// ratio test of the flight phase: over all i with |u_i| > tol,
+  /// lambdaM = min (lambdaM, u_i > 0 ? s_i / u_i : (1 - s_i) / u_i)
+  /// lambdaP = min (lambdaP, u_i > 0 ? (1 - s_i) / u_i : - s_i / u_i)
+  void   (*ratioTest) (const double *s, const double *u, int n, double tol, double *lambdaM, double *lambdaP);
+
+  /// sum of el_j * v [ind_j], j < nnz
+  double (*sparseDot) (const double *el, const int *ind, int nnz, const double *v);
+
+  /// u = v - Q' w, with Q a k x n matrix by columns (Q [i*k + j])
+  void   (*subGemv)   (const double *Q, int k, int n, const double *w, const double *v, double *u);
+};
+
+/// table chosen at the first call
+const calSimdKernels *calSimdInit ();
+
+extern const calSimdKernels *calSimdTable;
+
+inline const calSimdKernels *calSimd ()
+{return calSimdTable ? calSimdTable : calSimdInit ();}
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * optimal calibrated sampling -- build the model and run all replications
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <OsiClpSolverInterface.hpp>
+#include <CbcModel.hpp>
+#include <OsiAuxInfo.hpp>
+#include <CbcCutGenerator.hpp>
+
+#include "calInstance.hpp"
+#include "calModel.hpp"
+#include "calCut.hpp"
+#include "calBT.hpp"
+#include "calCube.hpp"
+#include "calBranch.hpp"
+#include "calBenders.hpp"
+#include "calWeights.hpp"
+#include "calEvent.hpp"
+#include "calClock.hpp"
+#include "calPool.hpp"
+#include "calOutput.hpp"
+#include "calProfile.hpp"
+#include "calTrace.hpp"
+#include "calPerf.hpp"
+
+//
+// Fill in LP's coefficient
+//
+
+int populate       (calInstance *instance, OsiSolverInterface *problem);
+int populateMaster (calInstance *instance, OsiSolverInterface *problem); // Benders master
+
+//
+// Presolve root MILP (bounds only, keeps the column layout)
+//
+
+int presolve (calInstance *instance, OsiSolverInterface *problem);
+
+//
+// Add cutting planes, heuristics, etc.
+//
+
+void addCbcExtras (calModel &calbb, int &cutGenCount);
+
+//
+// Build the (presolved) root MILP of instance in model
+//
+
+void calBuildRoot (calInstance *instance, OsiClpSolverInterface &model) {
+
+  calTraceSpan span ("build root MILP");
+
+  printf ("Creating MILP: ");
+  double nowTime = calWallTime ();
+  calPerfMark perf;
+  if (instance -> benders ()) populateMaster (instance, &model);
+  else                        populate       (instance, &model);
+  printf ("done (%gs)", calWallTime () - nowTime); perf. print (); printf ("\n");
+
+  model. messageHandler () -> setLogLevel (0);
+
+  // the Benders master has no rows linking theta to s: nothing to
+  // presolve, and reductions on theta would be wrong
+
+  if (!(instance -> noPresolve () || instance -> benders ())) {
+
+    printf ("Presolving root MILP: ");
+    nowTime = calWallTime ();
+
+    int nTight = presolve (instance, &model);
+
+    if (nTight < 0) printf ("infeasible, continuing without presolve (%gs)\n", calWallTime () - nowTime);
+    else            printf ("%d bounds tightened (%gs)\n", nTight, calWallTime () - nowTime);
+  }
+}
+
+//
+// Solve the instance (whose options are all set) and send the sample
+// of each replication to out. Used by main (), calibri::Sampler and
+// calDaemon (), which passes the root MILP it built for a previous
+// request. All state is in instance and in the objects created here:
+// the only way to stop it early, other than its deadline and time
+// limits, is the cancellation flag of instance. Returns the number of
+// replications that found a sample.
+//
+
+int calSolve (calInstance *instance, calOutput *out, const OsiClpSolverInterface *root) {
+
+  calTraceSpan span ("solve");
+
+  OsiClpSolverInterface model;
+
+  if (!root) {
+
+    if (!(instance -> noPresolve ())) {
+
+      int nRemoved = instance -> removeRedundantX ();
+
+      if (nRemoved)
+	printf ("Removed %d redundant calibration vector(s)\n", nRemoved);
+    }
+
+    instance -> print ();
+
+    calBuildRoot (instance, model);
+    root = &model;
+  }
+
+  calModel calbb (*root, instance);
+
+  calbb. messageHandler () -> setLogLevel ((calInstance::GLOBAL == instance -> algType ()) ? 1 : 0);
+
+  calbb. setAllowableGap (instance -> eps ());
+
+  calEventHandler eventHandler (instance); // stop BB as soon as a solution is below epsilon
+  calbb. passInEventHandler (&eventHandler);
+
+  calPool *pool = NULL;
+
+  if (instance -> poolSize () > 0) {
+    pool = new calPool (instance, instance -> poolSize (), instance -> eps ());
+    calbb. setPool (pool);
+  }
+
+  calPool *seen = NULL; // samples output so far, of any value
+
+  if (instance -> dupPolicy () != calInstance::DUP_ALLOW) {
+    seen = new calPool (instance, instance -> nReplications (), COIN_DBL_MAX);
+    calbb. setSeen (seen);
+  }
+
+  int cgCnt = 0;
+
+  addCbcExtras (calbb, cgCnt);
+
+  calWeights *weights = NULL;
+
+  CalCubeHeur calCube (calbb);
+  calCube. setCalModel (&calbb);
+  calCube. setInstance (instance);
+  calCube. setHeuristicName           ("Cube Method");
+
+  OsiBabSolver solverChar;
+  solverChar. setSolverType (3);
+
+  if (instance -> benders ()) {
+
+    // cuts must also be checked at integer solutions, which are
+    // otherwise accepted with theta below ||delta||
+
+    weights = new calWeights (instance);
+    calbb. setWeights (weights);
+
+    calBenders bgen (instance, weights);
+    calbb. addCutGenerator (&bgen, 1, "Benders cuts", true, true, false, 1);
+    calbb. cutGenerator (cgCnt++) -> setGlobalCuts (true);
+
+    solverChar. setSolverType (4);
+
+    calbb. solver () -> setAuxiliaryInfo (&solverChar);
+    calbb. passInSolverCharacteristics   (&solverChar);
+
+  } else {
+
+    calCut cutgen (instance);
+    calbb. addCutGenerator (&cutgen, 1, "Conic cuts", true, false, false, 1);
+    calbb. cutGenerator (cgCnt++) -> setGlobalCuts (true);
+
+    calBT  btgen (instance, &calbb); // only the cutoff bounds are global, propagation is local
+    calbb. addCutGenerator (&btgen, 1, "Bound Reduction", true, false, false, 1);
+    cgCnt++;
+
+    calbb. addHeuristic                (&calCube); // not necessary for now
+  }
+
+  // double objLimit;
+  // model.getDblParam (OsiDualObjectiveLimit, objLimit);
+
+  //calbb. solver           () -> setAuxiliaryInfo (&solverChar);
+  //calbb. passInSolverCharacteristics             (&solverChar);
+  //calbb. continuousSolver () -> setAuxiliaryInfo (&solverChar);
+
+  if (instance -> maxIterations () >= 0) calbb.setMaximumNumberIterations (instance -> maxIterations ());
+  if (instance -> maxBBnodes    () >= 0) calbb.setMaximumNodes            (instance -> maxBBnodes ());
+
+  printf ("Generating point(s) (%gs)\n", calWallTime ());
+
+  // if ((instance -> initType () == calInstance::LP_VALUE) &&   
+  //     (instance -> nReplications () != 1)) {
+  //   printf ("Initial weights set from LP but more than one repetition.\nResetting # repetitions to 1.\n");
+  //   instance -> nReplications () = 1;
+  // }
+
+  //int nFails = 0;
+  //#define MAX_FAILS 20
+
+  // MAIN LOOP:
+
+  out -> writeHeader ();
+
+  instance -> seedRandom ();
+
+  if (instance -> leverageBranch () ||
+      instance -> linkObjects ()) {
+
+    double *freq = NULL;
+
+    if (instance -> nSeedRuns () > 0) {
+
+      printf ("Seeding pseudocosts with %d Cube runs: ", instance -> nSeedRuns ()); fflush (stdout);
+      double nowTime = calWallTime ();
+      freq = calCube. inclusionFrequencies (instance -> nSeedRuns ());
+      printf ("done (%gs)\n", calWallTime () - nowTime);
+    }
+
+    addBranchObjects (calbb, instance, freq);
+
+    delete [] freq;
+  }
+
+  int nSamples = 0;
+
+  if (instance -> profileFile ())
+    instance -> profile () = new calProfile;
+
+  for (int iter=0; iter < instance -> nReplications (); ++iter) {
+
+    if (instance -> interrupted ()) {
+
+      printf ("Interrupted\n");
+      break;
+    }
+
+    if (calTimeLeft (instance -> deadline ()) <= 0.) {
+
+      printf ("Total time limit reached after %d replication(s)\n", iter);
+      break;
+    }
+
+    printf ("-------------- Replication %d:\n", 1+iter);
+
+    bool found = calbb. search (calCube, out, iter);
+
+    if (found)
+      ++nSamples;
+    else
+      printf ("Warning: no solution found at this replication.\n");
+
+    if (instance -> profile ())
+      instance -> profile () -> endReplication (iter, found);
+
+    // if ( || (nFails > MAX_FAILS) || (calInstance::GLOBAL == instance -> algType ())) {
+    //   ++iter;
+    //   nFails = 0;
+    // } else ++nFails;
+  }
+
+  if (pool) {
+    pool -> print ();
+    delete pool;
+  }
+
+  if (seen) {
+    seen -> print ("Samples output");
+    delete seen;
+  }
+
+  delete weights;
+
+  if (instance -> profile ()) {
+
+    if (instance -> profile () -> write (instance -> profileFile (), instance -> name (). c_str (),
+					 instance -> N (), instance -> n (), instance -> p ()))
+      printf ("Profiling report written to %s\n", instance -> profileFile ());
+    else
+      printf ("Error: cannot write profiling report to %s\n", instance -> profileFile ());
+
+    delete instance -> profile ();
+    instance -> profile () = NULL;
+  }
+
+  return nSamples;
+}
@@ -0,0 +1,138 @@
+/*
+ * optimal calibrated sampling -- synthetic populations
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "calSynth.hpp"
+#include "calRandom.hpp"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+calSynthSpec::calSynthSpec ():
+
+  N       (1000),
+  n       (100),
+  p       (4),
+  density (1.),
+  dist    (SYNTH_UNIFORM),
+  dupRate (0.),
+  seed    (1) {}
+
+calSynth::calSynth (const calSynthSpec &spec):
+
+  spec_  (spec),
+  pool_  (new double [SYNTH_DUP_POOL * spec.p]),
+  nPool_ (0),
+  next_  (0) {
+
+  calSeedRandom (rng_, spec.seed);
+}
+
+calSynth::~calSynth ()
+{delete [] pool_;}
+
+double calSynth::value () {
+
+  switch (spec_.dist) {
+
+  case SYNTH_BINARY: return 1.;
+
+  case SYNTH_LOGNORMAL: {
+
+    // Box-Muller; 1 - random () is in (0,1]
+
+    double z = sqrt (-2. * log (1. - calRandom (rng_))) * cos (2. * M_PI * calRandom (rng_));
+
+    double v = floor (SYNTH_MAX_VALUE / 10. * exp (z));
+
+    return 1. + ((v < 1e9) ? v : 1e9);
+  }
+
+  default: return 1 + (int) (SYNTH_MAX_VALUE * calRandom (rng_));
+  }
+}
+
+void calSynth::unit (double *x) {
+
+  int p = spec_.p;
+
+  if (nPool_ && (calRandom (rng_) < spec_.dupRate)) {
+
+    const double *dup = pool_ + p * (int) (nPool_ * calRandom (rng_));
+
+    for (int j=0; j<p; ++j)
+      x [j] = dup [j];
+
+    return;
+  }
+
+  for (int j=0; j<p; ++j)
+    x [j] = (calRandom (rng_) < spec_.density) ? value () : 0.;
+
+  for (int j=0; j<p; ++j)
+    pool_ [next_ * p + j] = x [j];
+
+  next_ = (next_ + 1) % SYNTH_DUP_POOL;
+
+  if (nPool_ < SYNTH_DUP_POOL)
+    ++nPool_;
+}
+
+double *calSynthX (const calSynthSpec &spec) {
+
+  // N * p may not fit in an int, nor its size in bytes in a size_t
+
+  if ((spec.N < 1) || (spec.p < 1) ||
+      ((size_t) spec.N > ((size_t) -1) / sizeof (double) / (size_t) spec.p))
+    return NULL;
+
+  calSynth synth (spec);
+
+  double *x = new double [(size_t) spec.N * (size_t) spec.p];
+
+  for (int i=0; i<spec.N; ++i)
+    synth.unit (x + (size_t) i * spec.p);
+
+  return x;
+}
+
+bool calSynthWrite (const char *filename, const calSynthSpec &spec, const double *x) {
+
+  FILE *f = fopen (filename, "w");
+
+  if (!f)
+    return false;
+
+  fprintf (f, "N %d\nn %d\np %d\ns %d\nx", spec.N, spec.n, spec.p, spec.seed);
+
+  calSynth synth (spec);
+
+  double *row = new double [spec.p];
+
+  for (int i=0; i<spec.N; ++i) {
+
+    const double *xi = x ? x + (size_t) i * spec.p : row;
+
+    if (!x)
+      synth.unit (row);
+
+    for (int j=0; j<spec.p; ++j)
+      fprintf (f, " %d", (int) xi [j]);
+
+    fprintf (f, "\n");
+  }
+
+  delete [] row;
+
+  bool ok = !ferror (f);
+
+  return (fclose (f) == 0) && ok;
+}
@@ -0,0 +1,73 @@
+/*
+ * optimal calibrated sampling -- synthetic populations
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calSynth_hpp
+#define calSynth_hpp
+
+//
+// Random populations for benchmarks and for the instance generator
+// (calGen.cpp). Calibration values are integer, as the instance parser
+// reads them with atoi (). Units are generated one at a time, so that
+// instance files of millions of units can be written without keeping
+// them in memory; a duplicate unit copies one of the last
+// SYNTH_DUP_POOL distinct ones.
+//
+
+#define SYNTH_MAX_VALUE 100  // uniform values are in [1,SYNTH_MAX_VALUE]
+#define SYNTH_DUP_POOL  1024 // distinct units a duplicate is drawn from
+
+enum calSynthDist {
+
+  SYNTH_UNIFORM,   ///< uniform in [1,SYNTH_MAX_VALUE]
+  SYNTH_BINARY,    ///< 1 (indicator variables)
+  SYNTH_LOGNORMAL  ///< 1 + floor (SYNTH_MAX_VALUE/10 * e^Z), Z standard normal: heavy-tailed
+};
+
+struct calSynthSpec {
+
+  int               N;       ///< population size
+  int               n;       ///< sample size
+  int               p;       ///< number of calibration vectors
+  double            density; ///< probability that a calibration value is nonzero
+  enum calSynthDist dist;    ///< distribution of the nonzero values
+  double            dupRate; ///< probability that a unit duplicates a previous one
+  int               seed;    ///< random seed
+
+  calSynthSpec ();
+};
+
+class calSynth {
+
+protected:
+
+  calSynthSpec   spec_;
+  unsigned short rng_ [3];
+  double        *pool_;  ///< last SYNTH_DUP_POOL distinct units, p values each
+  int            nPool_; ///< units in pool_
+  int            next_;  ///< where the next distinct unit goes
+
+  double value ();       ///< a nonzero value
+
+public:
+
+  calSynth (const calSynthSpec &spec);
+  ~calSynth ();
+
+  /// p values of the next unit
+  void unit (double *x);
+};
+
+/// N rows of p calibration values, or NULL if N or p is not positive
+/// or the size of N * p doubles overflows size_t
+double *calSynthX (const calSynthSpec &spec);
+
+/// write an instance file with population x, or with one generated
+/// unit by unit if x is NULL, and the sample size and seed of
+/// spec. Returns false if it cannot be written
+bool calSynthWrite (const char *filename, const calSynthSpec &spec, const double *x = 0);
+
+#endif
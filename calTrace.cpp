@@ -0,0 +1,167 @@
+/*
+ * optimal calibrated sampling -- timeline of the solver (Chrome trace)
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+#include "calTrace.hpp"
+
+volatile bool calTraceOn = false;
+
+struct calTraceRecord {
+
+  const char *name;
+  const char *argName;
+  long        arg;
+  double      start;
+  double      end;
+};
+
+// one per thread, written only by that thread
+
+struct calTraceRing {
+
+  calTraceRecord  events [TRACE_RING_SIZE];
+  long            nEvents;    ///< recorded so far: the last TRACE_RING_SIZE are kept
+  long            tid;
+  const char     *threadName;
+  calTraceRing   *next;       ///< in the list of all rings
+};
+
+static calTraceRing *volatile rings = NULL; // pushed to without locks
+static volatile long          nRings = 0;
+
+static THREAD_LOCAL calTraceRing *myRing = NULL;
+
+static char *traceFile = NULL;
+
+// ring of the calling thread, created and added to the list at its
+// first event
+
+static calTraceRing *ring () {
+
+  if (!myRing) {
+
+    calTraceRing *r = new calTraceRing;
+
+    r -> nEvents    = 0;
+    r -> threadName = NULL;
+
+    r -> next       = NULL;
+
+    // push r onto the list: each compare-and-swap returns the current
+    // head, which r must point to for the swap to succeed
+
+    calTraceRing *head;
+
+#ifdef _MSC_VER
+    r -> tid = InterlockedIncrement (&nRings);
+    while ((head = (calTraceRing *) InterlockedCompareExchangePointer ((PVOID volatile *) &rings, r, r -> next)) != r -> next)
+      r -> next = head;
+#else
+    r -> tid = __sync_add_and_fetch (&nRings, 1);
+    while ((head = __sync_val_compare_and_swap (&rings, r -> next, r)) != r -> next)
+      r -> next = head;
+#endif
+
+    myRing = r;
+  }
+
+  return myRing;
+}
+
+void calTraceEvent (const char *name, double start, double end, const char *argName, long arg) {
+
+  calTraceRing *r = ring ();
+
+  calTraceRecord &e = r -> events [r -> nEvents % TRACE_RING_SIZE];
+
+  e.name    = name;
+  e.argName = argName;
+  e.arg     = arg;
+  e.start   = start;
+  e.end     = end;
+
+  ++ (r -> nEvents);
+}
+
+void calTraceThread (const char *name) {
+
+  if (calTraceOn)
+    ring () -> threadName = name;
+}
+
+// write all rings as Chrome trace events (times in microseconds)
+
+static void calTraceFlush () {
+
+  if (!calTraceOn)
+    return;
+
+  calTraceOn = false;
+
+  FILE *f = fopen (traceFile, "w");
+
+  if (!f) {
+    printf ("Error: cannot write trace to %s\n", traceFile);
+    return;
+  }
+
+  fprintf (f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+
+  bool first = true;
+  long nDropped = 0;
+
+  for (calTraceRing *r = rings; r; r = r -> next) {
+
+    fprintf (f, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %ld, \"args\": {\"name\": \"%s\"}}",
+	     first ? "" : ",", r -> tid, r -> threadName ? r -> threadName : "thread");
+
+    first = false;
+
+    long k = (r -> nEvents > TRACE_RING_SIZE) ? r -> nEvents - TRACE_RING_SIZE : 0;
+
+    nDropped += k;
+
+    for (; k < r -> nEvents; ++k) {
+
+      calTraceRecord &e = r -> events [k % TRACE_RING_SIZE];
+
+      fprintf (f, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %ld, \"ts\": %.3f, \"dur\": %.3f",
+	       e.name, r -> tid, 1e6 * e.start, 1e6 * (e.end - e.start));
+
+      if (e.argName) fprintf (f, ", \"args\": {\"%s\": %ld}}", e.argName, e.arg);
+      else           fprintf (f, "}");
+    }
+  }
+
+  fprintf (f, "\n]}\n");
+  fclose (f);
+
+  if (nDropped) printf ("Trace written to %s (%ld oldest event(s) dropped)\n", traceFile, nDropped);
+  else          printf ("Trace written to %s\n", traceFile);
+}
+
+void calTraceStart (const char *filename) {
+
+  if (calTraceOn)
+    return;
+
+  traceFile = new char [1 + strlen (filename)];
+  strcpy (traceFile, filename);
+
+  calTraceOn = true;
+
+  atexit (calTraceFlush);
+}
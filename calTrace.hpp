@@ -0,0 +1,74 @@
+/*
+ * optimal calibrated sampling -- timeline of the solver (Chrome trace)
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calTrace_hpp
+#define calTrace_hpp
+
+#include <stdlib.h>
+
+#include "calClock.hpp"
+
+//
+// Trace recorder (option -Z): each calTraceSpan records when it was
+// created and destroyed, as a "complete" event of the Chrome trace
+// event format, which chrome://tracing and Perfetto display as a
+// timeline with one lane per thread. Spans mark replications, BB runs
+// (retries), flight phases, nested and light Cube heuristics, cut
+// rounds, and the stages of main () and of the batch pipeline.
+//
+// Each thread writes to its own ring buffer of TRACE_RING_SIZE
+// events, without locks; when full, the oldest events are
+// overwritten. The buffers are written to the trace file when the
+// program exits, after all threads are done.
+//
+// Unlike profiling (calProfile.hpp), tracing is process-wide, as the
+// timeline is: event names and argument names must be string
+// literals. When not enabled, a span costs a test of calTraceOn.
+//
+
+#define TRACE_RING_SIZE (1 << 16) // events kept per thread
+
+/// true once calTraceStart () is called
+extern volatile bool calTraceOn;
+
+/// enable tracing; events are written to filename at exit
+void calTraceStart  (const char *filename);
+
+/// name the calling thread's lane in the timeline
+void calTraceThread (const char *name);
+
+/// record an event, from start to end (calWallTime ()), with an
+/// optional integer argument (argName NULL: none)
+void calTraceEvent  (const char *name, double start, double end, const char *argName, long arg);
+
+class calTraceSpan {
+
+protected:
+
+  const char *name_;
+  const char *argName_;
+  long        arg_;
+  double      start_;   ///< negative if tracing is off
+
+public:
+
+  calTraceSpan (const char *name, const char *argName = NULL, long arg = 0):
+    name_    (name),
+    argName_ (argName),
+    arg_     (arg),
+    start_   (calTraceOn ? calWallTime () : -1.) {}
+
+  ~calTraceSpan () {
+    if (start_ >= 0.)
+      calTraceEvent (name_, start_, calWallTime (), argName_, arg_);
+  }
+
+  /// change the argument, e.g., to a result known at the end
+  void setArg (long arg) {arg_ = arg;}
+};
+
+#endif
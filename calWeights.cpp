@@ -0,0 +1,369 @@
+/*
+ * optimal calibrated sampling -- weight subproblem for fixed sample
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#include <math.h>
+
+#include <CoinHelperFunctions.hpp>
+#include <CoinFinite.hpp>
+
+#include "calWeights.hpp"
+#include "calInstance.hpp"
+
+//#define DEBUG
+
+calWeights::calWeights (calInstance *inst):
+
+  instance_ (inst),
+  N_        (inst -> N ()),
+  pp_       (inst -> p () + 1),
+  optimal_  (false) {
+
+  int p = pp_ - 1;
+
+  CoinPackedVector **X = inst -> X ();
+
+  // column-wise copy of the p calibration rows
+
+  colBeg_ = new int [N_ + 1];
+  CoinZeroN (colBeg_, N_ + 1);
+
+  T_ = new double [pp_];
+  CoinZeroN (T_, pp_);
+
+  int nnz = 0;
+
+  for (int j=0; j<p; ++j) {
+
+    const int    *ind = X [j] -> getIndices     ();
+    const double *val = X [j] -> getElements    ();
+    int           num = X [j] -> getNumElements ();
+
+    for (int k=0; k<num; ++k) {
+      ++colBeg_ [ind [k] + 1];
+      T_ [j] += val [k];
+    }
+
+    nnz += num;
+  }
+
+  for (int i=0; i<N_; ++i)
+    colBeg_ [i+1] += colBeg_ [i];
+
+  colInd_ = new int    [nnz];
+  colVal_ = new double [nnz];
+
+  int *cursor = CoinCopyOfArray (colBeg_, N_);
+
+  for (int j=0; j<p; ++j) {
+
+    const int    *ind = X [j] -> getIndices     ();
+    const double *val = X [j] -> getElements    ();
+    int           num = X [j] -> getNumElements ();
+
+    for (int k=0; k<num; ++k) {
+      colInd_ [cursor [ind [k]]]   = j;
+      colVal_ [cursor [ind [k]]++] = val [k];
+    }
+  }
+
+  delete [] cursor;
+
+  M_      = new double [pp_ * pp_];
+  L_      = new double [pp_ * pp_];
+  y_      = new double [pp_];
+  r_      = new double [pp_];
+  status_ = new char   [N_];
+}
+
+calWeights::~calWeights () {
+
+  delete [] colBeg_;
+  delete [] colInd_;
+  delete [] colVal_;
+  delete [] T_;
+  delete [] M_;
+  delete [] L_;
+  delete [] y_;
+  delete [] r_;
+  delete [] status_;
+}
+
+// a_i' v, where a_i = (x_i1 ... x_ip, 1) is the i-th column of A
+
+double calWeights::colDot (int i, const double *v) const {
+
+  double result = v [pp_ - 1];
+
+  for (int k = colBeg_ [i]; k < colBeg_ [i+1]; ++k)
+    result += colVal_ [k] * v [colInd_ [k]];
+
+  return result;
+}
+
+// M += sign * a_i a_i' (lower triangle, row-major; column indices of
+// each unit are sorted)
+
+void calWeights::updateM (int i, double sign) {
+
+  int pp = pp_;
+
+  M_ [pp * pp - 1] += sign;
+
+  for (int k = colBeg_ [i]; k < colBeg_ [i+1]; ++k) {
+
+    int    jk = colInd_ [k];
+    double xk = sign * colVal_ [k];
+
+    M_ [(pp-1) * pp + jk] += xk;
+
+    for (int h = colBeg_ [i]; h <= k; ++h)
+      M_ [jk * pp + colInd_ [h]] += xk * colVal_ [h];
+  }
+}
+
+// Solve for given s
+
+double calWeights::solve (const double *s, double *delta, double *coef, double *rhs) {
+
+  int
+    N  = N_,
+    pp = pp_,
+    n  = instance_ -> n ();
+
+  double
+    w0 = (double) N / n,
+    l  = -w0 + EPS_W,
+    u  = (double) N * N / n - w0,
+    f  = 0.;
+
+  // bounds: fixed at zero if s_i = 0
+
+  for (int i=0; i<N; ++i) {
+    status_ [i] = (u * s [i] - l * s [i] <= WEIGHTS_TOL) ? 2 : 0;
+    delta   [i] = 0.;
+  }
+
+  // M = A_F A_F', then updated as components enter or leave F:
+  // O(p^2) per change rather than O(N p^2) per iteration
+
+  CoinZeroN (M_, pp * pp);
+
+  for (int i=0; i<N; ++i)
+    if (!(status_ [i]))
+      updateM (i, 1.);
+
+  bool optimal = false;
+
+  optimal_ = false;
+
+  for (int iter = 0; iter < WEIGHTS_MAX_ITER; ++iter) {
+
+    // r' = T - w0 X s - A_B delta_B
+
+    CoinCopyN (T_, pp, r_);
+    r_ [pp-1] = 0.;
+
+    for (int i=0; i<N; ++i) {
+
+      double coeff = w0 * s [i] + (status_ [i] ? delta [i] : 0.);
+
+      if (coeff == 0.)
+	continue;
+
+      for (int k = colBeg_ [i]; k < colBeg_ [i+1]; ++k)
+	r_ [colInd_ [k]] -= colVal_ [k] * coeff;
+
+      if (status_ [i])
+	r_ [pp-1] -= delta [i];
+    }
+
+    // Cholesky of M (lower triangle, into L) with a small ridge, then
+    // y = M^-1 r'
+
+    CoinCopyN (M_, pp * pp, L_);
+
+    double trace = 0.;
+
+    for (int j=0; j<pp; ++j)
+      trace += L_ [j * pp + j];
+
+    double ridge = 1e-12 * (1. + trace / pp);
+
+    for (int j=0; j<pp; ++j) {
+
+      double &djj = L_ [j * pp + j];
+
+      djj += ridge;
+
+      for (int k=0; k<j; ++k)
+	djj -= L_ [j * pp + k] * L_ [j * pp + k];
+
+      djj = sqrt (CoinMax (djj, ridge));
+
+      for (int i=j+1; i<pp; ++i) {
+
+	double &dij = L_ [i * pp + j];
+
+	for (int k=0; k<j; ++k)
+	  dij -= L_ [i * pp + k] * L_ [j * pp + k];
+
+	dij /= djj;
+      }
+    }
+
+    for (int i=0; i<pp; ++i) { // forward
+      y_ [i] = r_ [i];
+      for (int k=0; k<i; ++k)
+	y_ [i] -= L_ [i * pp + k] * y_ [k];
+      y_ [i] /= L_ [i * pp + i];
+    }
+
+    for (int i=pp; i--;) { // backward
+      for (int k=i+1; k<pp; ++k)
+	y_ [i] -= L_ [k * pp + i] * y_ [k];
+      y_ [i] /= L_ [i * pp + i];
+    }
+
+    // delta_F = A_F' y is the target; move towards it from the current
+    // delta_F (within bounds) and stop at the first bound hit, which
+    // becomes active. Clipping all violated components at once instead
+    // can fix too many and leave A_F without full row rank
+
+    double alpha = 1.;
+    int    block = -1;
+
+    for (int i=0; i<N; ++i)
+
+      if (!(status_ [i])) {
+
+	double
+	  target = colDot (i, y_),
+	  step   = target - delta [i];
+
+	if      ((target < l * s [i] - WEIGHTS_TOL) && (step < 0.) && ((l * s [i] - delta [i]) > alpha * step)) {alpha = (l * s [i] - delta [i]) / step; block = i;}
+	else if ((target > u * s [i] + WEIGHTS_TOL) && (step > 0.) && ((u * s [i] - delta [i]) < alpha * step)) {alpha = (u * s [i] - delta [i]) / step; block = i;}
+      }
+
+    for (int i=0; i<N; ++i)
+      if (!(status_ [i]))
+	delta [i] += alpha * (colDot (i, y_) - delta [i]);
+
+    if (block >= 0) {
+      status_ [block] = (delta [block] < 0.) ? -1 : 1;
+      delta   [block] = (delta [block] < 0.) ? l * s [block] : u * s [block];
+      updateM (block, -1.);
+      continue;
+    }
+
+    f = 0.;
+
+    for (int i=0; i<N; ++i)
+      f += delta [i] * delta [i];
+
+    f = sqrt (f);
+
+    if (f < WEIGHTS_TOL) {
+      optimal = true;
+      break;
+    }
+
+    // release components at bounds whose multiplier has the wrong sign
+
+    bool released = false;
+
+    for (int i=0; i<N; ++i)
+
+      if ((status_ [i] == -1) || (status_ [i] == 1)) {
+
+	double nu = (colDot (i, y_) - delta [i]) / f;
+
+	if (((status_ [i] ==  1) && (nu < -WEIGHTS_TOL)) ||
+	    ((status_ [i] == -1) && (nu >  WEIGHTS_TOL))) {
+	  status_ [i] = 0;
+	  released = true;
+	  updateM (i, 1.);
+	}
+      }
+
+    if (!released) {
+      optimal = true;
+      break;
+    }
+  }
+
+  optimal_ = optimal;
+
+  // check A delta = r (may fail if A_F is rank deficient or F empty)
+
+  CoinCopyN (T_, pp, r_);
+  r_ [pp-1] = 0.;
+
+  double normT = 0.;
+
+  for (int j=0; j<pp; ++j)
+    normT += fabs (T_ [j]);
+
+  for (int i=0; i<N; ++i) {
+
+    double coeff = w0 * s [i] + delta [i];
+
+    for (int k = colBeg_ [i]; k < colBeg_ [i+1]; ++k)
+      r_ [colInd_ [k]] -= colVal_ [k] * coeff;
+
+    r_ [pp-1] -= delta [i];
+  }
+
+  for (int j=0; j<pp; ++j)
+    if (fabs (r_ [j]) > 1e3 * WEIGHTS_TOL * (1. + normT)) {
+#ifdef DEBUG
+      printf ("calWeights: residual %g on row %d\n", r_ [j], j);
+#endif
+      return COIN_DBL_MAX;
+    }
+
+  if (!optimal) {
+    f = 0.;
+    for (int i=0; i<N; ++i)
+      f += delta [i] * delta [i];
+    f = sqrt (f);
+  }
+
+  // cut theta >= lambda' T + sum_i s_i (-w0 lambda' x_i + l mu-_i - u
+  // mu+_i). Only if optimal: otherwise y is not dual feasible and the
+  // cut is not a lower bound
+
+  if (coef && optimal) {
+
+    CoinZeroN (coef, N);
+    *rhs = 0.;
+
+    if (f >= WEIGHTS_TOL) {
+
+      for (int j=0; j<pp; ++j)
+	*rhs += T_ [j] * y_ [j] / f; // T_ [pp-1] is zero
+
+      for (int i=0; i<N; ++i) {
+
+	double
+	  g  = colDot (i, y_) / f, // (A' lambda)_i
+	  nu = status_ [i] ? g - delta [i] / f : 0.,
+	  &c = coef [i];
+
+	c = -w0 * (g - y_ [pp-1] / f); // x_i' lambda, without the sum-of-deltas row
+
+	if      (nu > 0.) c -= u * nu;
+	else if (nu < 0.) c -= l * nu;
+      }
+    }
+  }
+
+#ifdef DEBUG
+  printf ("calWeights: ||delta|| = %g (%s)\n", f, optimal ? "optimal" : "not converged");
+#endif
+
+  return f;
+}
@@ -0,0 +1,81 @@
+/*
+ * optimal calibrated sampling -- weight subproblem for fixed sample
+ *
+ * (C) Pietro Belotti 2013. This code is released
+ * under the Eclipse Public License.
+ */
+
+#ifndef calWeights_hpp
+#define calWeights_hpp
+
+#include <stdlib.h>
+
+class calInstance;
+
+#define WEIGHTS_MAX_ITER 1000  // max # active-set iterations
+#define WEIGHTS_TOL      1e-7  // feasibility tolerance
+
+//
+// For a fixed s (possibly fractional), the continuous part of the
+// model is the projection problem
+//
+//   min  ||delta||_2
+//   s.t. sum_i x_ij (w0 s_i + delta_i) = T_j   j = 1..p
+//        sum_i delta_i                 = 0
+//        l s_i <= delta_i <= u s_i             i = 1..N
+//
+// with T_j = sum_i x_ij, l = -w0 + EPS_W, u = U - w0. Writing A for
+// the (p+1) x N matrix of the equations and r(s) for their right-hand
+// side, it is solved by an active-set method where each step is the
+// minimum-norm solution delta_F = A_F' (A_F A_F')^-1 (r - A_B delta_B)
+// on the free set F, with B the components at their bounds.
+//
+// Its dual gives, for any s, the lower bound
+//
+//   ||delta*(s)|| >= lambda' r(s) + sum_i s_i (l mu-_i - u mu+_i)
+//
+// with lambda = y/||delta*|| and mu+ - mu- = A'lambda - delta*/||delta*||
+// on B, which is affine in s and tight at the given s: a Benders
+// optimality cut.
+//
+
+class calWeights {
+
+protected:
+
+  calInstance *instance_;
+
+  int     N_;
+  int     pp_;     ///< p+1: calibration rows plus sum of deltas
+  int    *colBeg_; ///< column-wise copy of the calibration rows
+  int    *colInd_;
+  double *colVal_;
+  double *T_;      ///< calibration totals
+
+  double *M_;      ///< A_F A_F', (p+1) x (p+1), updated as F changes
+  double *L_;      ///< workspace, (p+1) x (p+1): Cholesky factor of M
+  double *y_;      ///< workspace, p+1
+  double *r_;      ///< workspace, p+1
+  char   *status_; ///< workspace, N: 0 free, -1/+1 at lower/upper, 2 fixed
+  bool    optimal_; ///< last solve () converged
+
+  double  colDot  (int i, const double *v) const; ///< a_i' v
+  void    updateM (int i, double sign);           ///< M += sign * a_i a_i'
+
+public:
+
+  calWeights  (calInstance *inst);
+  ~calWeights ();
+
+  /// Solve for given s. Fills delta (N elements) and, if coef != NULL
+  /// and the active-set method converged, the cut theta >= rhs + sum_i
+  /// coef_i s_i. Returns ||delta||_2, or COIN_DBL_MAX if no feasible
+  /// delta was found.
+  double solve (const double *s, double *delta, double *coef = NULL, double *rhs = NULL);
+
+  /// true if the last solve () converged. If not, delta is feasible but
+  /// maybe not optimal, and neither the cut nor infeasibility is valid
+  bool optimal () const {return optimal_;}
+};
+
+#endif
@@ -208,3 +208,27 @@ void print_help (char *pname, tpar *opt) {
     printf ("%-40s %s\n", helpline, opt [i].help);
   }
 }
+
+
+/*
+ * Read a comma-separated list of at most max numbers (an option's
+ * value); returns how many were read
+ */
+
+int read_list (const char *s, double *list, int max) {
+
+  int n = 0;
+  char *end;
+
+  for (; s && *s && (n < max); s = (*end == ',') ? end + 1 : end) {
+
+    list [n] = strtod (s, &end);
+
+    if (end == s)
+      break;
+
+    ++n;
+  }
+
+  return n;
+}
@@ -20,7 +20,7 @@ enum etype {TTOGGLE, TCHAR, TINT, TDOUBLE, TSTRING};
  *  option, and a help message to be displayed on "--help".
  */
 
-typedef struct {
+typedef struct tpar {
 
   char shortopt;   /**< Short option character */
   char *longopt;   /**< Long option string     */
@@ -42,4 +42,6 @@ void print_help (char *, tpar *);              /* print help message */
 
 void set_default_args (tpar *);                /* set default values in options */
 
+int read_list (const char *, double *, int);   /* comma-separated numbers */
+
 #endif